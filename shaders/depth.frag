@@ -13,7 +13,8 @@ layout (location = 0) in vec2 inUv;
 // layout (early_fragment_tests) in;
 
 vec4 sampleTexture(uint index) {
-    return texture(textures[nonuniformEXT(index)], inUv);
+    uint slot = PushConstants.sceneData.textureSlots.slots[index];
+    return texture(textures[nonuniformEXT(slot)], inUv);
 }
 
 void main() {
@@ -7,7 +7,7 @@
 layout(location = 0) out vec2 outUv;
 
 void main() {
-    Vertex vertex = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
+    Vertex vertex = loadVertex(gl_VertexIndex);
     gl_Position = PushConstants.sceneData.viewproj * PushConstants.transform * vec4(vertex.position, 1.0f);
     outUv = vec2(vertex.uv_x, vertex.uv_y);
 }
@@ -35,13 +35,27 @@ vec3(1.0, 3.0, 1.0)
 );
 
 vec4 sampleTexture(uint index) {
-    return texture(textures[nonuniformEXT(index)], inUv);
+    uint slot = PushConstants.sceneData.textureSlots.slots[index];
+
+    // Record the finest level sampled for texture streaming. The unclamped
+    // LOD in y goes below zero when finer levels than the resident ones are
+    // wanted; x is clamped to the levels of the view.
+    float lod = textureQueryLod(textures[nonuniformEXT(slot)], inUv).y;
+    uint mip = uint(max(lod + TEXTURE_FEEDBACK_BIAS, 0.0));
+    TextureFeedbackBuffer feedback = PushConstants.sceneData.textureFeedback;
+    if (mip < feedback.mips[index]) {
+        atomicMin(feedback.mips[index], mip);
+    }
+
+    return texture(textures[nonuniformEXT(slot)], inUv);
 }
 
 vec3 getNormalFromMap() {
     MaterialData material = PushConstants.sceneData.materials.data[PushConstants.materialId];
 
-    vec3 tangentNormal = sampleTexture(material.normalTex).xyz * 2.0 - 1.0;
+    // Normal maps may be BC5 compressed, which only stores X and Y.
+    vec2 xy = sampleTexture(material.normalTex).xy * 2.0 - 1.0;
+    vec3 tangentNormal = vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
 
     return inTBN * normalize(tangentNormal);
 }
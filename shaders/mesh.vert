@@ -10,7 +10,7 @@ layout(location = 2) out vec2 outUv;
 layout(location = 3) out mat3 outTBN;
 
 void main() {
-    Vertex vertex = PushConstants.vertexBuffer.vertices[gl_VertexIndex];
+    Vertex vertex = loadVertex(gl_VertexIndex);
     vec4 worldPosition = PushConstants.transform * vec4(vertex.position, 1.0f);
     outPos = worldPosition.xyz;
 
@@ -10,4 +10,14 @@ layout (push_constant, scalar) uniform constants {
     SceneDataBuffer sceneData;
     VertexBuffer vertexBuffer;
     uint materialId;
+    uint vertexFormat;
+    vec3 positionMin;
+    vec3 positionExtent;
 } PushConstants;
+
+Vertex loadVertex(uint index) {
+    return decodeVertex(
+        PushConstants.vertexBuffer, PushConstants.vertexFormat, PushConstants.positionMin,
+        PushConstants.positionExtent, index
+    );
+}
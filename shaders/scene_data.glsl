@@ -5,6 +5,7 @@
 #extension GL_EXT_buffer_reference : require
 
 #include "material.glsl"
+#include "texture_streaming.glsl"
 
 layout (buffer_reference, scalar) readonly buffer SceneDataBuffer {
     mat4 view;
@@ -16,6 +17,8 @@ layout (buffer_reference, scalar) readonly buffer SceneDataBuffer {
     vec4 sunlightDirection; // w for sun power
     vec4 sunlightColor;
     MaterialsBuffer materials;
+    TextureFeedbackBuffer textureFeedback;
+    TextureSlotsBuffer textureSlots;
 };
 
 #endif
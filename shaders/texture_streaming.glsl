@@ -0,0 +1,20 @@
+#ifndef UB_TEXTURE_STREAMING
+#define UB_TEXTURE_STREAMING
+
+#extension GL_EXT_buffer_reference : require
+
+// Finest mip level each texture was sampled at this frame, relative to the
+// first resident level plus TEXTURE_FEEDBACK_BIAS. Read back by the
+// TextureManager to stream levels in and out.
+#define TEXTURE_FEEDBACK_BIAS 16
+
+layout (buffer_reference, std430) buffer TextureFeedbackBuffer {
+    uint mips[];
+};
+
+// Descriptor in the bindless array each texture is currently sampled through.
+layout (buffer_reference, std430) readonly buffer TextureSlotsBuffer {
+    uint slots[];
+};
+
+#endif
@@ -3,6 +3,11 @@
 
 #extension GL_EXT_buffer_reference : require
 
+// Must match yuubi::VertexFormat.
+#define VERTEX_FORMAT_FULL 0
+#define VERTEX_FORMAT_COMPACT 1
+#define VERTEX_FORMAT_COMPACT_COLOR 2
+
 struct Vertex {
     vec3 position;
     float uv_x;
@@ -16,4 +21,46 @@ layout(buffer_reference, std430) readonly buffer VertexBuffer {
     Vertex vertices[];
 };
 
+// Compact vertices are read word by word:
+//   0: position x, y (unorm16 fractions of the mesh bounds)
+//   1: position z (unorm16), bitangent sign (snorm16)
+//   2: uv (half2)
+//   3: normal (octahedral snorm16x2)
+//   4: tangent (octahedral snorm16x2)
+//   5: color (unorm8x4), VERTEX_FORMAT_COMPACT_COLOR only
+layout(buffer_reference, std430) readonly buffer PackedVertexBuffer {
+    uint words[];
+};
+
+vec3 octahedralDecode(vec2 encoded) {
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+Vertex decodeVertex(VertexBuffer buffer, uint format, vec3 positionMin, vec3 positionExtent, uint index) {
+    if (format == VERTEX_FORMAT_FULL) {
+        return buffer.vertices[index];
+    }
+
+    PackedVertexBuffer packed = PackedVertexBuffer(buffer);
+    uint base = index * (format == VERTEX_FORMAT_COMPACT_COLOR ? 6 : 5);
+    uint positionZTangentSign = packed.words[base + 1];
+    vec2 uv = unpackHalf2x16(packed.words[base + 2]);
+
+    Vertex vertex;
+    vertex.position = positionMin + vec3(
+        unpackUnorm2x16(packed.words[base]), unpackUnorm2x16(positionZTangentSign).x
+    ) * positionExtent;
+    vertex.uv_x = uv.x;
+    vertex.uv_y = uv.y;
+    vertex.normal = octahedralDecode(unpackSnorm2x16(packed.words[base + 3]));
+    vertex.color = format == VERTEX_FORMAT_COMPACT_COLOR ? unpackUnorm4x8(packed.words[base + 5]) : vec4(1.0);
+    vertex.tangent = vec4(
+        octahedralDecode(unpackSnorm2x16(packed.words[base + 4])), unpackSnorm2x16(positionZTangentSign).y
+    );
+    return vertex;
+}
+
 #endif
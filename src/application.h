@@ -18,7 +18,7 @@ struct AppState {
 
 class Application {
 public:
-    explicit Application(std::string_view gltfPath);
+    explicit Application(std::string_view scenePath);
 
     ~Application();
 
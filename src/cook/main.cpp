@@ -0,0 +1,109 @@
+#include "core/job_system.h"
+#include "core/log.h"
+#include "cook/texture_cooker.h"
+#include "renderer/gltf/cooked_asset.h"
+#include "renderer/gltf/import.h"
+#include "renderer/gltf/mapped_gltf.h"
+#include "renderer/gltf/thread.h"
+#include "pch.h"
+#include <chrono>
+#include <fastgltf/core.hpp>
+#include <print>
+
+// Cooks a glTF file into a package GLTFAsset can load without any of the CPU
+// heavy processing: images are mipped and block-compressed, and meshes are
+// converted to the engine's vertex layout with tangents.
+//
+// The package is written to the output directory as <name>.ybasset, with one
+// KTX2 file per image under textures/. Vertices are compact unless
+// --full-vertices is given.
+int main(int argc, const char** argv) {
+    Log::Init();
+    const bool fullVertices = argc == 4 && std::string_view(argv[3]) == "--full-vertices";
+    if (argc != 3 && !fullVertices) {
+        std::println("Usage: {} [filepath].gltf [output directory] [--full-vertices]", argv[0]);
+        return 1;
+    }
+
+    const std::filesystem::path inputPath = argv[1];
+    const std::filesystem::path outputDir = argv[2];
+    const auto start = std::chrono::steady_clock::now();
+
+    const auto gltf = yuubi::MappedGltf::load(inputPath);
+    if (!gltf.has_value()) {
+        std::println("Unable to load file: {}", inputPath.string());
+        return 1;
+    }
+    const auto& asset = gltf->asset();
+
+    std::filesystem::create_directories(outputDir / "textures");
+
+    yuubi::CookedAsset cooked{
+        .materials = yuubi::importMaterials(asset),
+        .nodes = yuubi::importNodes(asset),
+    };
+
+    auto& jobSystem = yuubi::JobSystem::get();
+
+    const auto importStart = std::chrono::steady_clock::now();
+    std::vector<yuubi::ImportedMesh> meshes(asset.meshes.size());
+    jobSystem.parallelFor(asset.meshes.size(), [&](size_t i) {
+        meshes[i] = yuubi::importMesh(
+            asset, asset.meshes[i], cooked.materials,
+            fullVertices ? yuubi::VertexFormat::Full : yuubi::VertexFormat::Compact
+        );
+    });
+    cooked.meshes = meshes | std::views::transform(&yuubi::ImportedMesh::view) | std::ranges::to<std::vector>();
+    const auto importSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - importStart).count();
+    const auto megabytes =
+        static_cast<double>(std::ranges::fold_left(
+            meshes | std::views::transform(&yuubi::ImportedMesh::sourceBytes), 0uz, std::plus{}
+        )) /
+        (1024 * 1024);
+    std::println(
+        "Cooked {} meshes from {:.1f} MB of accessors in {:.2f}s ({:.1f} MB/s)", cooked.meshes.size(), megabytes,
+        importSeconds, megabytes / importSeconds
+    );
+
+    // Images are cooked once, however many textures sample them.
+    const auto imagePath = [](size_t imageIndex) {
+        return std::filesystem::path("textures") / std::format("{}.ktx2", imageIndex);
+    };
+    for (const auto& [i, texture]: std::views::enumerate(asset.textures)) {
+        cooked.textures.push_back({
+            .image = imagePath(yuubi::getTextureImage(asset, i)),
+            .sampler = yuubi::importSampler(asset, texture),
+        });
+    }
+
+    auto images = yuubi::loadImages(asset, inputPath.parent_path());
+    const auto roles = yuubi::getImageRoles(asset);
+    std::atomic<size_t> cookedImages = 0;
+    std::atomic<size_t> failedImages = 0;
+    jobSystem.parallelFor(asset.images.size(), [&](size_t i) {
+        if (!roles[i].has_value()) {
+            return;
+        }
+
+        const auto image = yuubi::cookTexture(std::move(images[i]), *roles[i]);
+        if (!image.writeToFile(outputDir / imagePath(i))) {
+            // The runtime falls back to the error texture.
+            std::println("Unable to cook image {}", i);
+            failedImages++;
+        }
+        cookedImages++;
+    });
+    std::println(
+        "Cooked {} images for {} textures ({} failed)", cookedImages.load(), cooked.textures.size(),
+        failedImages.load()
+    );
+
+    const auto packagePath = outputDir / inputPath.stem().replace_extension(yuubi::cookedAssetExtension);
+    if (!yuubi::writeCookedAsset(packagePath, cooked)) {
+        std::println("Unable to write {}", packagePath.string());
+        return 1;
+    }
+
+    const auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+    std::println("Wrote {} in {:.2f}s", packagePath.string(), duration.count());
+}
@@ -0,0 +1,144 @@
+#include "cook/texture_cooker.h"
+
+#include "core/pixels.h"
+#include <glm/glm.hpp>
+#include <ktx.h>
+
+namespace {
+
+    float srgbToLinear(float value) {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(float value) {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    struct MipLevel {
+        uint32_t width;
+        uint32_t height;
+        std::vector<glm::u8vec4> pixels;
+    };
+
+    MipLevel baseLevel(const yuubi::ImageData& image) {
+        MipLevel level{.width = image.width, .height = image.height};
+        level.pixels.resize(static_cast<size_t>(image.width) * image.height);
+        yuubi::expandToRgba(
+            image.pixels, image.numChannels, level.pixels.size(), reinterpret_cast<unsigned char*>(level.pixels.data())
+        );
+        return level;
+    }
+
+    // Box filters level down to half its size. Color is averaged in linear
+    // space and normals are renormalized.
+    MipLevel downsample(const MipLevel& level, yuubi::TextureRole role) {
+        MipLevel result{.width = std::max(level.width / 2, 1u), .height = std::max(level.height / 2, 1u)};
+        result.pixels.resize(static_cast<size_t>(result.width) * result.height);
+
+        const auto decode = [role](glm::u8vec4 pixel) {
+            auto value = glm::vec4(pixel) / 255.0f;
+            if (role == yuubi::TextureRole::Color) {
+                value = {srgbToLinear(value.r), srgbToLinear(value.g), srgbToLinear(value.b), value.a};
+            } else if (role == yuubi::TextureRole::Normal) {
+                value = glm::vec4(glm::vec3(value) * 2.0f - 1.0f, value.a);
+            }
+            return value;
+        };
+        const auto encode = [role](glm::vec4 value) {
+            if (role == yuubi::TextureRole::Color) {
+                value = {linearToSrgb(value.r), linearToSrgb(value.g), linearToSrgb(value.b), value.a};
+            } else if (role == yuubi::TextureRole::Normal) {
+                const auto length = glm::length(glm::vec3(value));
+                const auto normal = length > 0.0f ? glm::vec3(value) / length : glm::vec3{0.0f, 0.0f, 1.0f};
+                value = glm::vec4(normal * 0.5f + 0.5f, value.a);
+            }
+            return glm::u8vec4(glm::round(glm::clamp(value, 0.0f, 1.0f) * 255.0f));
+        };
+
+        for (uint32_t y = 0; y < result.height; y++) {
+            for (uint32_t x = 0; x < result.width; x++) {
+                glm::vec4 sum{0.0f};
+                for (uint32_t dy = 0; dy < 2; dy++) {
+                    for (uint32_t dx = 0; dx < 2; dx++) {
+                        const uint32_t sourceX = std::min(x * 2 + dx, level.width - 1);
+                        const uint32_t sourceY = std::min(y * 2 + dy, level.height - 1);
+                        sum += decode(level.pixels[static_cast<size_t>(sourceY) * level.width + sourceX]);
+                    }
+                }
+                result.pixels[static_cast<size_t>(y) * result.width + x] = encode(sum / 4.0f);
+            }
+        }
+
+        return result;
+    }
+
+}
+
+namespace yuubi {
+
+    KtxImageData cookTexture(TextureImageData&& image, TextureRole role) {
+        if (auto* ktxImage = std::get_if<KtxImageData>(&image)) {
+            return std::move(*ktxImage);
+        }
+
+        const auto imageData = std::get<DecodedImageData>(image).imageData();
+        if (imageData.pixels == nullptr) {
+            return {};
+        }
+
+        std::vector<MipLevel> levels;
+        levels.push_back(baseLevel(imageData));
+        while (levels.back().width > 1 || levels.back().height > 1) {
+            levels.push_back(downsample(levels.back(), role));
+        }
+
+        const ktxTextureCreateInfo createInfo{
+            .vkFormat = static_cast<uint32_t>(
+                role == TextureRole::Color ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm
+            ),
+            .baseWidth = imageData.width,
+            .baseHeight = imageData.height,
+            .baseDepth = 1,
+            .numDimensions = 2,
+            .numLevels = static_cast<uint32_t>(levels.size()),
+            .numLayers = 1,
+            .numFaces = 1,
+            .isArray = KTX_FALSE,
+            .generateMipmaps = KTX_FALSE,
+        };
+
+        ktxTexture2* texture = nullptr;
+        auto result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &texture);
+        if (result != KTX_SUCCESS) {
+            UB_ERROR("Unable to create KTX2 image: {}", ktxErrorString(result));
+            return {};
+        }
+
+        for (const auto& [i, level]: std::views::enumerate(levels)) {
+            ktxTexture_SetImageFromMemory(
+                ktxTexture(texture), static_cast<uint32_t>(i), 0, 0,
+                reinterpret_cast<const ktx_uint8_t*>(level.pixels.data()), level.pixels.size() * sizeof(glm::u8vec4)
+            );
+        }
+
+        // UASTC transcodes to every BCn format with little loss. Images are
+        // cooked in parallel, so each one is compressed on a single thread.
+        ktxBasisParams params{
+            .structSize = sizeof(ktxBasisParams),
+            .uastc = KTX_TRUE,
+            .threadCount = 1,
+        };
+        params.uastcFlags = KTX_PACK_UASTC_LEVEL_DEFAULT;
+
+        result = ktxTexture2_CompressBasisEx(texture, &params);
+        if (result != KTX_SUCCESS) {
+            UB_ERROR("Unable to compress KTX2 image: {}", ktxErrorString(result));
+            ktxTexture_Destroy(ktxTexture(texture));
+            return {};
+        }
+
+        // Transcode offline so the runtime can upload the result directly.
+        return KtxImageData(texture, role);
+    }
+
+}
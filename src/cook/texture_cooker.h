@@ -0,0 +1,13 @@
+#pragma once
+
+#include "renderer/gltf/ktx_image_data.h"
+#include "renderer/gltf/thread.h"
+#include "pch.h"
+
+namespace yuubi {
+
+    // Builds the full mip chain of image and block-compresses it in the format
+    // the runtime uses for role. KTX2 sources are passed through.
+    [[nodiscard]] KtxImageData cookTexture(TextureImageData&& image, TextureRole role);
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "pch.h"
+
+namespace yuubi {
+
+    // Mixes value into hash. Multiply-xorshift, as used by splitmix64.
+    constexpr uint64_t hashCombine(uint64_t hash, uint64_t value) {
+        value *= 0x9e3779b97f4a7c15ull;
+        value ^= value >> 32;
+        hash = (hash ^ value) * 0xd6e8feb86659fd93ull;
+        return hash ^ (hash >> 32);
+    }
+
+    // Fast non-cryptographic hash for content keyed caches. Consumes eight
+    // bytes per step. Anything persisted under it must also be keyed by a
+    // version, as the function may change.
+    inline uint64_t hashBytes(std::span<const char> bytes, uint64_t seed = 0) {
+        uint64_t hash = hashCombine(seed, bytes.size());
+
+        size_t offset = 0;
+        for (; offset + sizeof(uint64_t) <= bytes.size(); offset += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, bytes.data() + offset, sizeof(word));
+            hash = hashCombine(hash, word);
+        }
+
+        if (offset < bytes.size()) {
+            uint64_t tail = 0;
+            std::memcpy(&tail, bytes.data() + offset, bytes.size() - offset);
+            hash = hashCombine(hash, tail);
+        }
+        return hash;
+    }
+
+}
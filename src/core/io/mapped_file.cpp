@@ -0,0 +1,81 @@
+#include "core/io/mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace yuubi {
+
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::filesystem::path& path) {
+        const HANDLE file = CreateFileW(
+            path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+        );
+        if (file == INVALID_HANDLE_VALUE) {
+            return;
+        }
+
+        LARGE_INTEGER size{};
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+            // The view keeps the file and the mapping alive until it is
+            // unmapped, so neither handle is needed past this point.
+            if (const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+                data_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                size_ = data_ != nullptr ? static_cast<size_t>(size.QuadPart) : 0;
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+    }
+
+    MappedFile::~MappedFile() {
+        if (data_ != nullptr) {
+            UnmapViewOfFile(data_);
+        }
+    }
+#else
+    MappedFile::MappedFile(const std::filesystem::path& path) {
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            return;
+        }
+
+        struct stat status{};
+        if (fstat(file, &status) == 0 && status.st_size > 0) {
+            // The mapping outlives the descriptor.
+            void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (data != MAP_FAILED) {
+                data_ = data;
+                size_ = static_cast<size_t>(status.st_size);
+            }
+        }
+        close(file);
+    }
+
+    MappedFile::~MappedFile() {
+        if (data_ != nullptr) {
+            munmap(data_, size_);
+        }
+    }
+#endif
+
+    MappedFile::MappedFile(MappedFile&& rhs) noexcept :
+        data_(std::exchange(rhs.data_, nullptr)), size_(std::exchange(rhs.size_, 0)) {}
+
+    MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept {
+        if (this != &rhs) {
+            std::swap(data_, rhs.data_);
+            std::swap(size_, rhs.size_);
+        }
+
+        return *this;
+    }
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "pch.h"
+
+namespace yuubi {
+
+    // A whole file mapped read-only into memory. Pages are read in by the OS
+    // on first access, so opening a large file costs next to nothing, and
+    // data can be copied from the mapping straight into staging memory.
+    class MappedFile : NonCopyable {
+    public:
+        MappedFile() = default;
+        // Leaves the file closed if it does not exist, is empty or cannot be
+        // mapped.
+        explicit MappedFile(const std::filesystem::path& path);
+        MappedFile(MappedFile&& rhs) noexcept;
+        MappedFile& operator=(MappedFile&& rhs) noexcept;
+        ~MappedFile();
+
+        [[nodiscard]] bool isOpen() const { return data_ != nullptr; }
+        // The mapping is page aligned.
+        [[nodiscard]] std::span<const char> bytes() const { return {static_cast<const char*>(data_), size_}; }
+
+    private:
+        void* data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+}
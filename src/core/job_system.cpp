@@ -0,0 +1,250 @@
+#include "core/job_system.h"
+
+namespace {
+
+    // Worker running on the calling thread, if any.
+    thread_local const yuubi::JobSystem* currentJobSystem = nullptr;
+    thread_local uint32_t currentWorkerIndex = 0;
+
+    // Attempts to find work a waiter yields for before it starts sleeping,
+    // and the longest it sleeps between attempts.
+    constexpr uint32_t waitSpins = 64;
+    constexpr std::chrono::microseconds maxWaitSleep{1000};
+
+}
+
+namespace yuubi {
+
+    JobSystem::JobSystem(uint32_t numWorkers) {
+        numWorkers = std::max(numWorkers, 1u);
+
+        for (uint32_t i = 0; i < numWorkers; i++) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        for (uint32_t i = 0; i < numWorkers; i++) {
+            threads_.emplace_back([this, i] { workerLoop(i); });
+        }
+
+        UB_INFO("Started job system with {} workers", numWorkers);
+    }
+
+    JobSystem::~JobSystem() {
+        {
+            std::lock_guard lock(sleepMutex_);
+            stopping_ = true;
+        }
+        wakeCondition_.notify_all();
+
+        threads_.clear();
+    }
+
+    JobSystem& JobSystem::get() {
+        static JobSystem jobSystem(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+        return jobSystem;
+    }
+
+    JobHandle JobSystem::schedule(std::function<void()> function, std::span<const JobHandle> dependencies) {
+        JobHandle job{new Job(std::move(function))};
+
+        for (const auto& dependency: dependencies) {
+            std::lock_guard lock(dependency->continuationMutex_);
+            if (!dependency->finished_.load(std::memory_order_relaxed)) {
+                job->pendingDependencies_.fetch_add(1, std::memory_order_relaxed);
+                dependency->continuations_.push_back(job);
+            }
+        }
+
+        // Drop the reference held while scheduling.
+        if (job->pendingDependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            enqueue(job);
+        }
+
+        return job;
+    }
+
+    void JobSystem::wait(const JobHandle& job) {
+        helpUntilFinished(job);
+        if (job->exception_ != nullptr) {
+            std::rethrow_exception(job->exception_);
+        }
+    }
+
+    void JobSystem::helpUntilFinished(const JobHandle& job) {
+        const auto workerIndex =
+            currentJobSystem == this ? std::optional<uint32_t>(currentWorkerIndex) : std::nullopt;
+
+        // Jobs that run long have the waiter spin on an empty queue, so it
+        // yields at first and then sleeps for longer and longer.
+        uint32_t idleAttempts = 0;
+        auto sleep = std::chrono::microseconds{10};
+        while (!job->isFinished()) {
+            bool stolen = false;
+            if (auto other = findJob(workerIndex, stolen)) {
+                execute(other, workerIndex, stolen);
+                idleAttempts = 0;
+                sleep = std::chrono::microseconds{10};
+            } else if (idleAttempts++ < waitSpins) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(sleep);
+                sleep = std::min(sleep * 2, maxWaitSleep);
+            }
+        }
+    }
+
+    void JobSystem::parallelFor(size_t count, const std::function<void(size_t)>& function, size_t grainSize) {
+        grainSize = std::max<size_t>(grainSize, 1);
+
+        std::vector<JobHandle> jobs;
+        jobs.reserve((count + grainSize - 1) / grainSize);
+        for (size_t begin = 0; begin < count; begin += grainSize) {
+            const size_t end = std::min(begin + grainSize, count);
+            jobs.push_back(schedule([&function, begin, end] {
+                for (size_t i = begin; i < end; i++) {
+                    function(i);
+                }
+            }));
+        }
+
+        // Jobs reference function, so all of them must finish before an
+        // exception leaves.
+        for (const auto& job: jobs) {
+            helpUntilFinished(job);
+        }
+        for (const auto& job: jobs) {
+            if (job->exception_ != nullptr) {
+                std::rethrow_exception(job->exception_);
+            }
+        }
+    }
+
+    std::vector<JobSystem::WorkerStats> JobSystem::stats() const {
+        return workers_ | std::views::transform([](const auto& worker) {
+                   return WorkerStats{
+                       .jobsExecuted = worker->jobsExecuted.load(std::memory_order_relaxed),
+                       .jobsStolen = worker->jobsStolen.load(std::memory_order_relaxed),
+                       .busyTime = std::chrono::nanoseconds{worker->busyNanoseconds.load(std::memory_order_relaxed)}
+                   };
+               }) |
+               std::ranges::to<std::vector>();
+    }
+
+    void JobSystem::workerLoop(uint32_t workerIndex) {
+        currentJobSystem = this;
+        currentWorkerIndex = workerIndex;
+
+        while (true) {
+            bool stolen = false;
+            if (auto job = findJob(workerIndex, stolen)) {
+                execute(job, workerIndex, stolen);
+                continue;
+            }
+
+            std::unique_lock lock(sleepMutex_);
+            wakeCondition_.wait(lock, [this] { return stopping_ || queuedJobs_.load() > 0; });
+            if (stopping_) {
+                return;
+            }
+        }
+    }
+
+    void JobSystem::enqueue(JobHandle job) {
+        if (currentJobSystem == this) {
+            auto& worker = *workers_[currentWorkerIndex];
+            std::lock_guard lock(worker.mutex);
+            worker.jobs.push_back(std::move(job));
+        } else {
+            std::lock_guard lock(sharedMutex_);
+            sharedJobs_.push_back(std::move(job));
+        }
+        queuedJobs_.fetch_add(1);
+
+        // Taking the lock ensures a worker that is about to sleep sees the new
+        // job before it waits.
+        { std::lock_guard lock(sleepMutex_); }
+        wakeCondition_.notify_one();
+    }
+
+    JobHandle JobSystem::findJob(std::optional<uint32_t> workerIndex, bool& stolen) {
+        const auto take = [this](std::deque<JobHandle>& jobs, bool fromBack) {
+            JobHandle job;
+            if (fromBack) {
+                job = std::move(jobs.back());
+                jobs.pop_back();
+            } else {
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            queuedJobs_.fetch_sub(1);
+            return job;
+        };
+
+        // Newest work first from our own deque, since it is most likely to be
+        // in cache.
+        if (workerIndex.has_value()) {
+            auto& worker = *workers_[*workerIndex];
+            std::lock_guard lock(worker.mutex);
+            if (!worker.jobs.empty()) {
+                return take(worker.jobs, true);
+            }
+        }
+
+        {
+            std::lock_guard lock(sharedMutex_);
+            if (!sharedJobs_.empty()) {
+                return take(sharedJobs_, false);
+            }
+        }
+
+        // Steal the oldest work from everyone else.
+        const uint32_t start = workerIndex.value_or(0);
+        for (uint32_t i = 1; i <= workers_.size(); i++) {
+            const uint32_t victimIndex = (start + i) % workers_.size();
+            if (victimIndex == workerIndex) {
+                continue;
+            }
+
+            auto& victim = *workers_[victimIndex];
+            std::lock_guard lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                stolen = true;
+                return take(victim.jobs, false);
+            }
+        }
+
+        return nullptr;
+    }
+
+    void JobSystem::execute(const JobHandle& job, std::optional<uint32_t> workerIndex, bool stolen) {
+        const auto start = std::chrono::steady_clock::now();
+        try {
+            job->function_();
+        } catch (...) {
+            job->exception_ = std::current_exception();
+        }
+        const auto duration = std::chrono::steady_clock::now() - start;
+
+        if (workerIndex.has_value()) {
+            auto& worker = *workers_[*workerIndex];
+            worker.jobsExecuted.fetch_add(1, std::memory_order_relaxed);
+            worker.jobsStolen.fetch_add(stolen ? 1 : 0, std::memory_order_relaxed);
+            worker.busyNanoseconds.fetch_add(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed
+            );
+        }
+
+        std::vector<JobHandle> continuations;
+        {
+            std::lock_guard lock(job->continuationMutex_);
+            job->finished_.store(true, std::memory_order_release);
+            continuations = std::move(job->continuations_);
+        }
+
+        for (auto& continuation: continuations) {
+            if (continuation->pendingDependencies_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                enqueue(std::move(continuation));
+            }
+        }
+    }
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "core/util.h"
+#include "pch.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace yuubi {
+
+    class Job : NonCopyableOrMovable {
+    public:
+        [[nodiscard]] bool isFinished() const { return finished_.load(std::memory_order_acquire); }
+
+    private:
+        friend class JobSystem;
+
+        explicit Job(std::function<void()> function) : function_(std::move(function)) {}
+
+        std::function<void()> function_;
+        // Thrown by function_, rethrown by JobSystem::wait(). Written before
+        // finished_ is set.
+        std::exception_ptr exception_;
+        // Unfinished dependencies, plus one while the job is being scheduled.
+        std::atomic<uint32_t> pendingDependencies_ = 1;
+        std::atomic<bool> finished_ = false;
+
+        // Jobs that depend on this one.
+        std::mutex continuationMutex_;
+        std::vector<std::shared_ptr<Job>> continuations_;
+    };
+
+    using JobHandle = std::shared_ptr<Job>;
+
+    // Work-stealing job scheduler shared by the whole engine.
+    //
+    // Each worker owns a deque. It pushes and pops its own jobs at the back,
+    // and idle workers steal from the front of other deques, so a single long
+    // job never holds up the jobs queued behind it. Jobs scheduled from
+    // outside the pool go through a shared queue.
+    //
+    // Threads that wait on a job run other jobs until it has finished, so jobs
+    // may themselves schedule and wait on further jobs. Waiters back off to
+    // sleeping when there is nothing to run.
+    //
+    // An exception thrown by a job is stored and rethrown by wait(). Jobs
+    // that depend on it still run.
+    class JobSystem : NonCopyableOrMovable {
+    public:
+        struct WorkerStats {
+            uint64_t jobsExecuted = 0;
+            uint64_t jobsStolen = 0;
+            std::chrono::nanoseconds busyTime{0};
+        };
+
+        explicit JobSystem(uint32_t numWorkers);
+        ~JobSystem();
+
+        // Shared instance with one worker per hardware thread, leaving one for
+        // the main thread.
+        static JobSystem& get();
+
+        // Runs function once every job in dependencies has finished.
+        JobHandle schedule(std::function<void()> function, std::span<const JobHandle> dependencies = {});
+        // Runs other jobs until job has finished, and rethrows the exception
+        // it threw, if any.
+        void wait(const JobHandle& job);
+        // Calls function for every index in [0, count) and waits for all of
+        // them. Indices are grouped into jobs of grainSize. Rethrows the first
+        // exception thrown once every job has finished.
+        void parallelFor(size_t count, const std::function<void(size_t)>& function, size_t grainSize = 1);
+
+        [[nodiscard]] uint32_t numWorkers() const { return static_cast<uint32_t>(workers_.size()); }
+        // Cumulative statistics per worker.
+        [[nodiscard]] std::vector<WorkerStats> stats() const;
+
+    private:
+        struct Worker {
+            std::mutex mutex;
+            std::deque<JobHandle> jobs;
+
+            std::atomic<uint64_t> jobsExecuted = 0;
+            std::atomic<uint64_t> jobsStolen = 0;
+            std::atomic<int64_t> busyNanoseconds = 0;
+        };
+
+        void workerLoop(uint32_t workerIndex);
+        // Runs other jobs until job has finished.
+        void helpUntilFinished(const JobHandle& job);
+        void enqueue(JobHandle job);
+        // Looks for work in the calling worker's deque, then the shared queue,
+        // then the other workers' deques.
+        [[nodiscard]] JobHandle findJob(std::optional<uint32_t> workerIndex, bool& stolen);
+        void execute(const JobHandle& job, std::optional<uint32_t> workerIndex, bool stolen);
+
+        std::vector<std::unique_ptr<Worker>> workers_;
+
+        std::mutex sharedMutex_;
+        std::deque<JobHandle> sharedJobs_;
+
+        std::mutex sleepMutex_;
+        std::condition_variable wakeCondition_;
+        std::atomic<size_t> queuedJobs_ = 0;
+        bool stopping_ = false;
+
+        std::vector<std::jthread> threads_;
+    };
+
+}
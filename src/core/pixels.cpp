@@ -0,0 +1,122 @@
+#include "core/pixels.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define UB_PIXELS_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__) || defined(__AVX__)
+#define UB_PIXELS_SSSE3
+#include <tmmintrin.h>
+#endif
+
+namespace {
+
+    constexpr uint32_t opaque = 0xff000000;
+
+    // Scalar builds leave every pixel to the caller's loop.
+    size_t expandGray(
+        [[maybe_unused]] const unsigned char* src, [[maybe_unused]] size_t count, [[maybe_unused]] unsigned char* dst
+    ) {
+        size_t i = 0;
+#ifdef UB_PIXELS_SSE2
+        const auto alpha = _mm_set1_epi32(static_cast<int>(opaque));
+        for (; i + 16 <= count; i += 16) {
+            const auto gray = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            const auto low = _mm_unpacklo_epi8(gray, gray);
+            const auto high = _mm_unpackhi_epi8(gray, gray);
+            auto* out = reinterpret_cast<__m128i*>(dst + i * 4);
+            _mm_storeu_si128(out, _mm_or_si128(_mm_unpacklo_epi16(low, low), alpha));
+            _mm_storeu_si128(out + 1, _mm_or_si128(_mm_unpackhi_epi16(low, low), alpha));
+            _mm_storeu_si128(out + 2, _mm_or_si128(_mm_unpacklo_epi16(high, high), alpha));
+            _mm_storeu_si128(out + 3, _mm_or_si128(_mm_unpackhi_epi16(high, high), alpha));
+        }
+#endif
+        return i;
+    }
+
+    size_t expandGrayAlpha(
+        [[maybe_unused]] const unsigned char* src, [[maybe_unused]] size_t count, [[maybe_unused]] unsigned char* dst
+    ) {
+        size_t i = 0;
+#ifdef UB_PIXELS_SSE2
+        // Each pixel is widened to g | a << 8 and becomes
+        // g | g << 8 | (g | a << 8) << 16.
+        const auto grayMask = _mm_set1_epi32(0xff);
+        const auto expand = [&](__m128i pixels) {
+            const auto gray = _mm_and_si128(pixels, grayMask);
+            return _mm_or_si128(_mm_or_si128(gray, _mm_slli_epi32(gray, 8)), _mm_slli_epi32(pixels, 16));
+        };
+        const auto zero = _mm_setzero_si128();
+        for (; i + 8 <= count; i += 8) {
+            const auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+            auto* out = reinterpret_cast<__m128i*>(dst + i * 4);
+            _mm_storeu_si128(out, expand(_mm_unpacklo_epi16(pixels, zero)));
+            _mm_storeu_si128(out + 1, expand(_mm_unpackhi_epi16(pixels, zero)));
+        }
+#endif
+        return i;
+    }
+
+    size_t expandRgb(const unsigned char* src, size_t count, unsigned char* dst) {
+        size_t i = 0;
+#ifdef UB_PIXELS_SSSE3
+        // Four pixels per shuffle. Each load reads a pixel and a third past
+        // them, so the last few pixels are left to the scalar loop.
+        const auto shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const auto alpha = _mm_set1_epi32(static_cast<int>(opaque));
+        for (; i * 3 + 16 <= count * 3; i += 4) {
+            const auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha)
+            );
+        }
+#else
+        // Without a byte shuffle, four pixels are spread over three words.
+        for (; i + 4 <= count; i += 4) {
+            std::array<uint32_t, 3> words;
+            std::memcpy(words.data(), src + i * 3, sizeof(words));
+            const std::array pixels{
+                words[0] | opaque,
+                (words[0] >> 24 | words[1] << 8) | opaque,
+                (words[1] >> 16 | words[2] << 16) | opaque,
+                words[2] >> 8 | opaque,
+            };
+            std::memcpy(dst + i * 4, pixels.data(), sizeof(pixels));
+        }
+#endif
+        return i;
+    }
+
+}
+
+namespace yuubi {
+
+    void expandToRgba(const unsigned char* src, uint32_t channels, size_t count, unsigned char* dst) {
+        size_t i = 0;
+        switch (channels) {
+            case 1:
+                i = expandGray(src, count, dst);
+                break;
+            case 2:
+                i = expandGrayAlpha(src, count, dst);
+                break;
+            case 3:
+                i = expandRgb(src, count, dst);
+                break;
+            default:
+                std::memcpy(dst, src, count * 4);
+                return;
+        }
+
+        for (; i < count; i++) {
+            const auto* pixel = src + i * channels;
+            const std::array<unsigned char, 4> rgba =
+                channels == 3 ? std::array<unsigned char, 4>{pixel[0], pixel[1], pixel[2], 255}
+                              : std::array<unsigned char, 4>{
+                                    pixel[0], pixel[0], pixel[0], channels == 2 ? pixel[1] : uint8_t{255}
+                                };
+            std::memcpy(dst + i * 4, rgba.data(), rgba.size());
+        }
+    }
+
+}
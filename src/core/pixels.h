@@ -0,0 +1,13 @@
+#pragma once
+
+#include "pch.h"
+
+namespace yuubi {
+
+    // Expands count tightly packed 8-bit pixels of channels channels to RGBA,
+    // the way glTF reads them: gray is replicated to RGB and missing alpha is
+    // opaque. Runs a few pixels per SIMD register, so it can write straight
+    // into staging memory in the same pass that copies the pixels.
+    void expandToRgba(const unsigned char* src, uint32_t channels, size_t count, unsigned char* dst);
+
+}
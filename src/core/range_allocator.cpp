@@ -0,0 +1,84 @@
+#include "core/range_allocator.h"
+#include <cassert>
+
+namespace yuubi {
+
+    RangeAllocator::RangeAllocator(uint64_t size) : size_(size), freeSize_(size) {
+        if (size > 0) {
+            freeRanges_.emplace(0, size);
+        }
+    }
+
+    std::optional<uint64_t> RangeAllocator::allocate(uint64_t size, uint64_t alignment) {
+        if (size == 0) {
+            return std::nullopt;
+        }
+
+        for (auto it = freeRanges_.begin(); it != freeRanges_.end(); ++it) {
+            const auto [rangeOffset, rangeSize] = *it;
+            const uint64_t offset = (rangeOffset + alignment - 1) / alignment * alignment;
+            const uint64_t padding = offset - rangeOffset;
+            if (padding + size > rangeSize) {
+                continue;
+            }
+
+            // Keep the padding and the tail as separate free ranges.
+            freeRanges_.erase(it);
+            if (padding > 0) {
+                freeRanges_.emplace(rangeOffset, padding);
+            }
+            if (padding + size < rangeSize) {
+                freeRanges_.emplace(offset + size, rangeSize - padding - size);
+            }
+
+            freeSize_ -= size;
+            return offset;
+        }
+
+        return std::nullopt;
+    }
+
+    void RangeAllocator::free(uint64_t offset, uint64_t size) {
+        if (size == 0) {
+            return;
+        }
+        assert(offset + size <= size_);
+        freeSize_ += size;
+
+        auto next = freeRanges_.lower_bound(offset);
+        assert(next == freeRanges_.end() || next->first >= offset + size);
+
+        // Merge with the following range.
+        if (next != freeRanges_.end() && next->first == offset + size) {
+            size += next->second;
+            next = freeRanges_.erase(next);
+        }
+
+        // Merge with the preceding range.
+        if (next != freeRanges_.begin()) {
+            auto previous = std::prev(next);
+            assert(previous->first + previous->second <= offset);
+            if (previous->first + previous->second == offset) {
+                previous->second += size;
+                return;
+            }
+        }
+
+        freeRanges_.emplace_hint(next, offset, size);
+    }
+
+    void RangeAllocator::grow(uint64_t size) {
+        assert(size >= size_);
+        const auto oldSize = std::exchange(size_, size);
+        free(oldSize, size - oldSize);
+    }
+
+    uint64_t RangeAllocator::largestFreeRange() const {
+        uint64_t largest = 0;
+        for (const auto size: freeRanges_ | std::views::values) {
+            largest = std::max(largest, size);
+        }
+        return largest;
+    }
+
+}
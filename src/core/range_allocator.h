@@ -0,0 +1,36 @@
+#pragma once
+
+#include "pch.h"
+#include <map>
+
+namespace yuubi {
+
+    // First-fit allocator over the offsets [0, size). Free ranges are kept
+    // sorted by offset and merged with their neighbours when released, so
+    // space freed by many small allocations can be reused by a large one.
+    // Only hands out offsets; the memory itself is owned by the caller.
+    class RangeAllocator {
+    public:
+        RangeAllocator() = default;
+        explicit RangeAllocator(uint64_t size);
+
+        // Returns the offset of size free units aligned to alignment, or
+        // nothing if no free range is large enough.
+        [[nodiscard]] std::optional<uint64_t> allocate(uint64_t size, uint64_t alignment = 1);
+        // Releases a range returned by allocate().
+        void free(uint64_t offset, uint64_t size);
+        // Extends the allocator to [0, size). Shrinking isn't supported.
+        void grow(uint64_t size);
+
+        [[nodiscard]] uint64_t size() const { return size_; }
+        [[nodiscard]] uint64_t freeSize() const { return freeSize_; }
+        [[nodiscard]] uint64_t largestFreeRange() const;
+
+    private:
+        // Offset to size of each free range.
+        std::map<uint64_t, uint64_t> freeRanges_;
+        uint64_t size_ = 0;
+        uint64_t freeSize_ = 0;
+    };
+
+}
@@ -5,7 +5,7 @@
 int main(int argc, const char** argv) {
     Log::Init();
     if (argc != 2) {
-        std::println("Usage: {} [filepath].gltf", argv[0]);
+        std::println("Usage: {} [filepath].gltf|.ybasset|.ybscene", argv[0]);
     }
     Application app(argv[1]);
     app.run();
@@ -3,6 +3,9 @@
 #include "renderer/vma/allocator.h"
 #include "renderer/vma/image.h"
 #include "renderer/vma/buffer.h"
+#include "renderer/vma/staging_allocator.h"
+#include "renderer/mip_generator.h"
+#include "renderer/sampler_cache.h"
 #include "pch.h"
 
 namespace util {
@@ -17,6 +20,35 @@ namespace util {
         UB_ERROR("Cannot find graphics queue family index");
         return -1;
     }
+
+    // Prefers a transfer-only family, then an async compute family, so that
+    // uploads run alongside rendering. Families that can't copy at texel
+    // granularity are skipped.
+    uint32_t findTransferQueueFamilyIndex(
+        const vk::raii::PhysicalDevice& physicalDevice, uint32_t graphicsFamilyIndex
+    ) {
+        const auto properties = physicalDevice.getQueueFamilyProperties();
+
+        const auto find = [&](vk::QueueFlags required, vk::QueueFlags excluded) -> std::optional<uint32_t> {
+            for (const auto [i, p]: std::views::enumerate(properties)) {
+                const auto granularity = p.minImageTransferGranularity;
+                if ((p.queueFlags & required) == required && !(p.queueFlags & excluded) && granularity.width == 1 &&
+                    granularity.height == 1 && granularity.depth == 1) {
+                    return static_cast<uint32_t>(i);
+                }
+            }
+            return std::nullopt;
+        };
+
+        if (auto index =
+                find(vk::QueueFlagBits::eTransfer, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)) {
+            return *index;
+        }
+        if (auto index = find(vk::QueueFlagBits::eCompute, vk::QueueFlagBits::eGraphics)) {
+            return *index;
+        }
+        return graphicsFamilyIndex;
+    }
 }
 
 namespace yuubi {
@@ -68,6 +100,24 @@ namespace yuubi {
             vk::PhysicalDeviceVulkan13Features>();
 
         // TODO: compare all features
+        auto availableFeatures = supportedFeatures.get<vk::PhysicalDeviceFeatures2>().features;
+        auto requiredFeatures = requiredFeatures_.get<vk::PhysicalDeviceFeatures2>().features;
+        if (requiredFeatures.fragmentStoresAndAtomics && !availableFeatures.fragmentStoresAndAtomics) {
+            return false;
+        }
+        if (requiredFeatures.shaderStorageImageReadWithoutFormat &&
+            !availableFeatures.shaderStorageImageReadWithoutFormat) {
+            return false;
+        }
+        if (requiredFeatures.shaderStorageImageWriteWithoutFormat &&
+            !availableFeatures.shaderStorageImageWriteWithoutFormat) {
+            return false;
+        }
+        if (requiredFeatures.shaderStorageImageArrayDynamicIndexing &&
+            !availableFeatures.shaderStorageImageArrayDynamicIndexing) {
+            return false;
+        }
+
         auto availableFeatures11 = supportedFeatures.get<vk::PhysicalDeviceVulkan11Features>();
         auto requiredFeatures11 = requiredFeatures_.get<vk::PhysicalDeviceVulkan11Features>();
 
@@ -79,6 +129,9 @@ namespace yuubi {
         if (requiredFeatures12.bufferDeviceAddress && !availableFeatures12.bufferDeviceAddress) {
             return false;
         }
+        if (requiredFeatures12.timelineSemaphore && !availableFeatures12.timelineSemaphore) {
+            return false;
+        }
 
         auto availableFeatures13 = supportedFeatures.get<vk::PhysicalDeviceVulkan13Features>();
         auto requiredFeatures13 = requiredFeatures_.get<vk::PhysicalDeviceVulkan13Features>();
@@ -95,17 +148,42 @@ namespace yuubi {
     void Device::createLogicalDevice(const vk::raii::Instance& instance) {
         constexpr float priority = 1.0f;
         const auto graphicsFamilyIndex = util::findGraphicsQueueFamilyIndex(physicalDevice_);
+        const auto transferFamilyIndex = util::findTransferQueueFamilyIndex(physicalDevice_, graphicsFamilyIndex);
 
-        const vk::DeviceQueueCreateInfo queueCreateInfo{
-            .queueFamilyIndex = graphicsFamilyIndex, .queueCount = 1, .pQueuePriorities = &priority
+        std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos{
+            {.queueFamilyIndex = graphicsFamilyIndex, .queueCount = 1, .pQueuePriorities = &priority}
         };
+        if (transferFamilyIndex != graphicsFamilyIndex) {
+            queueCreateInfos.push_back(
+                {.queueFamilyIndex = transferFamilyIndex, .queueCount = 1, .pQueuePriorities = &priority}
+            );
+        }
+
+        // Memory budget lets VMA report the heap budget the driver actually
+        // grants the process instead of estimating it from the heap sizes.
+        auto extensions = requiredExtensions_;
+        const bool memoryBudget = std::ranges::any_of(
+            physicalDevice_.enumerateDeviceExtensionProperties(),
+            [](const vk::ExtensionProperties& extension) {
+                return std::string_view(extension.extensionName) == vk::EXTMemoryBudgetExtensionName;
+            }
+        );
+        if (memoryBudget) {
+            extensions.push_back(vk::EXTMemoryBudgetExtensionName);
+        }
+
+        // BCn formats are used when the device has them. Without them, Basis
+        // Universal textures are transcoded to RGBA8 instead.
+        auto features = requiredFeatures_;
+        textureCompressionBC_ = physicalDevice_.getFeatures().textureCompressionBC == vk::True;
+        features.get<vk::PhysicalDeviceFeatures2>().features.textureCompressionBC = textureCompressionBC_;
 
         const vk::DeviceCreateInfo createInfo{
-            .pNext = &requiredFeatures_.get(),
-            .queueCreateInfoCount = 1,
-            .pQueueCreateInfos = &queueCreateInfo,
-            .enabledExtensionCount = static_cast<uint32_t>(requiredExtensions_.size()),
-            .ppEnabledExtensionNames = requiredExtensions_.data()
+            .pNext = &features.get(),
+            .queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()),
+            .pQueueCreateInfos = queueCreateInfos.data(),
+            .enabledExtensionCount = static_cast<uint32_t>(extensions.size()),
+            .ppEnabledExtensionNames = extensions.data()
         };
 
         device_ = vk::raii::Device{physicalDevice_, createInfo};
@@ -114,18 +192,38 @@ namespace yuubi {
             .queue = device_.getQueue2({.queueFamilyIndex = graphicsFamilyIndex, .queueIndex = 0}),
             .familyIndex = graphicsFamilyIndex
         };
+        transferQueue_ = {
+            .queue = device_.getQueue2({.queueFamilyIndex = transferFamilyIndex, .queueIndex = 0}),
+            .familyIndex = transferFamilyIndex
+        };
+        UB_INFO(
+            "Using queue family {} for graphics and {} for transfer", graphicsFamilyIndex, transferFamilyIndex
+        );
+
+        const vk::StructureChain<vk::SemaphoreCreateInfo, vk::SemaphoreTypeCreateInfo> timelineCreateInfo{
+            {},
+            {.semaphoreType = vk::SemaphoreType::eTimeline, .initialValue = 0}
+        };
+        uploadTimeline_ = vk::raii::Semaphore{device_, timelineCreateInfo.get()};
 
-        allocator_ = std::make_shared<Allocator>(instance, physicalDevice_, device_);
+        allocator_ = std::make_shared<Allocator>(instance, physicalDevice_, device_, memoryBudget);
+        stagingAllocator_ = std::make_shared<StagingAllocator>(allocator_.get());
+        mipGenerator_ = std::make_shared<MipGenerator>(*this);
+        samplerCache_ = std::make_shared<SamplerCache>(
+            device_, physicalDevice_.getProperties().limits.maxSamplerAnisotropy
+        );
     }
 
     vk::raii::ImageView Device::createImageView(
         const vk::Image& image, const vk::Format& format, vk::ImageAspectFlags aspectFlags, uint32_t mipLevels,
-        const vk::ImageViewType type
+        const vk::ImageViewType type, vk::ImageUsageFlags usage
     ) const {
         // TODO: this looks ugly
         const uint32_t numLayers = type == vk::ImageViewType::eCube ? 6 : 1;
 
+        const vk::ImageViewUsageCreateInfo viewUsage{.usage = usage};
         vk::ImageViewCreateInfo const viewInfo{
+            .pNext = usage ? &viewUsage : nullptr,
             .image = image,
             .viewType = type,
             .format = format,
@@ -186,17 +284,58 @@ namespace yuubi {
         vk::CommandBufferSubmitInfo const commandBufferSubmitInfo{
             .commandBuffer = *immediateCommandBuffer_,
         };
+        submit(
+            graphicsQueue_,
+            vk::SubmitInfo2{.commandBufferInfoCount = 1, .pCommandBufferInfos = &commandBufferSubmitInfo},
+            *immediateCommandFence_
+        );
+
+        device_.waitForFences({*immediateCommandFence_}, vk::True, std::numeric_limits<uint64_t>::max());
+    }
+
+    uint64_t Device::submitUpload(vk::CommandBuffer commandBuffer, vk::Semaphore waitSemaphore) const {
+        const vk::CommandBufferSubmitInfo commandBufferSubmitInfo{.commandBuffer = commandBuffer};
+        const vk::SemaphoreSubmitInfo waitInfo{
+            .semaphore = waitSemaphore, .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+        };
+
+        // Only the graphics queue signals the upload timeline, and values are
+        // taken under the queue lock, so they are signalled in order.
+        std::lock_guard lock(queueMutex_);
+        const uint64_t signalValue = ++uploadTimelineValue_;
+        const vk::SemaphoreSubmitInfo signalInfo{
+            .semaphore = *uploadTimeline_, .value = signalValue, .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+        };
+
         graphicsQueue_.queue.submit2(
             {
                 vk::SubmitInfo2{
+                                .waitSemaphoreInfoCount = waitSemaphore ? 1u : 0u,
+                                .pWaitSemaphoreInfos = &waitInfo,
                                 .commandBufferInfoCount = 1,
                                 .pCommandBufferInfos = &commandBufferSubmitInfo,
+                                .signalSemaphoreInfoCount = 1,
+                                .pSignalSemaphoreInfos = &signalInfo,
                                 }
-        },
-            *immediateCommandFence_
+        }
         );
 
-        device_.waitForFences({*immediateCommandFence_}, vk::True, std::numeric_limits<uint64_t>::max());
+        return signalValue;
+    }
+
+    void Device::submit(const Queue& queue, const vk::SubmitInfo2& submitInfo, vk::Fence fence) const {
+        std::lock_guard lock(queueMutex_);
+        queue.queue.submit2({submitInfo}, fence);
+    }
+
+    vk::Result Device::present(const vk::PresentInfoKHR& presentInfo) const {
+        std::lock_guard lock(queueMutex_);
+        return graphicsQueue_.queue.presentKHR(presentInfo);
+    }
+
+    void Device::waitIdle() const {
+        std::lock_guard lock(queueMutex_);
+        device_.waitIdle();
     }
 
     const vk::StructureChain<
@@ -204,7 +343,16 @@ namespace yuubi {
         vk::PhysicalDeviceVulkan13Features, vk::PhysicalDeviceDynamicRenderingLocalReadFeaturesKHR,
         vk::PhysicalDeviceUnifiedImageLayoutsFeaturesKHR>
         Device::requiredFeatures_{
-            vk::PhysicalDeviceFeatures2{.features = {.multiViewport = vk::True, .samplerAnisotropy = vk::True}},
+            vk::PhysicalDeviceFeatures2{
+                .features = {
+                             .multiViewport = vk::True,
+                             .samplerAnisotropy = vk::True,
+                             .fragmentStoresAndAtomics = vk::True,
+                             .shaderStorageImageReadWithoutFormat = vk::True,
+                             .shaderStorageImageWriteWithoutFormat = vk::True,
+                             .shaderStorageImageArrayDynamicIndexing = vk::True,
+                             }
+            },
             vk::PhysicalDeviceVulkan11Features{.multiview = vk::True},
             vk::PhysicalDeviceVulkan12Features{
                                         .descriptorIndexing = vk::True,
@@ -216,6 +364,7 @@ namespace yuubi {
                                         .runtimeDescriptorArray = vk::True,
                                         .scalarBlockLayout = vk::True,
                                         .hostQueryReset = vk::True,
+                                        .timelineSemaphore = vk::True,
                                         .bufferDeviceAddress = vk::True,
                                         },
             vk::PhysicalDeviceVulkan13Features{.synchronization2 = vk::True, .dynamicRendering = vk::True},
@@ -4,11 +4,15 @@
 #include "renderer/vma/allocator.h"
 #include "renderer/vulkan_usage.h"
 #include "renderer/vma/buffer.h"
+#include <mutex>
 
 namespace yuubi {
 
     class Buffer;
     class Image;
+    class StagingAllocator;
+    class MipGenerator;
+    class SamplerCache;
     struct ImageCreateInfo;
 
     struct Queue {
@@ -16,30 +20,55 @@ namespace yuubi {
         uint32_t familyIndex;
     };
 
-    class Device : NonCopyable {
+    class Device : NonCopyableOrMovable {
     public:
-        Device() = default;
-        ~Device() = default;
-        Device(Device&&) = default;
-        Device& operator=(Device&&) = default;
         Device(const vk::raii::Instance& instance, const vk::raii::SurfaceKHR& surface);
 
         [[nodiscard]] const vk::raii::Device& getDevice() const { return device_; }
         [[nodiscard]] const vk::raii::PhysicalDevice& getPhysicalDevice() const { return physicalDevice_; }
 
+        // The view inherits the usage of the image unless usage is given.
         [[nodiscard]] vk::raii::ImageView createImageView(
             const vk::Image& image, const vk::Format& format, vk::ImageAspectFlags aspectFlags, uint32_t mipLevels = 1,
-            vk::ImageViewType type = vk::ImageViewType::e2D
+            vk::ImageViewType type = vk::ImageViewType::e2D, vk::ImageUsageFlags usage = {}
         ) const;
 
         [[nodiscard]] const Queue& getQueue() const { return graphicsQueue_; }
+        // Queue used for uploads. Falls back to the graphics queue when the
+        // device has no separate transfer or compute family.
+        [[nodiscard]] const Queue& getTransferQueue() const { return transferQueue_; }
+        [[nodiscard]] bool hasDedicatedTransferQueue() const {
+            return transferQueue_.familyIndex != graphicsQueue_.familyIndex;
+        }
+        // Whether BCn images can be sampled. Mobile GPUs often lack them.
+        [[nodiscard]] bool supportsBlockCompression() const { return textureCompressionBC_; }
+
+        // Timeline semaphore signalled by upload submissions. Resources are only
+        // made visible to rendering once the timeline has passed the value of
+        // their upload, and frame submissions wait on the current value to
+        // make those writes visible.
+        [[nodiscard]] const vk::raii::Semaphore& getUploadTimeline() const { return uploadTimeline_; }
+        // Submits upload work to the graphics queue, optionally waiting for
+        // work on another queue first, and returns the upload timeline value
+        // signalled once it completes.
+        uint64_t submitUpload(vk::CommandBuffer commandBuffer, vk::Semaphore waitSemaphore = nullptr) const;
 
         [[nodiscard]] Allocator& allocator() const { return *allocator_; }
+        [[nodiscard]] StagingAllocator& stagingAllocator() const { return *stagingAllocator_; }
+        [[nodiscard]] const MipGenerator& mipGenerator() const { return *mipGenerator_; }
+        // Shared by every texture, so identical samplers are only created once.
+        [[nodiscard]] SamplerCache& samplerCache() const { return *samplerCache_; }
 
         [[nodiscard]] Image createImage(const ImageCreateInfo& createInfo) const;
         [[nodiscard]] Buffer createBuffer(
             const vk::BufferCreateInfo& createInfo, const VmaAllocationCreateInfo& allocInfo
         ) const;
+        // Queues are externally synchronized, and uploads are submitted from
+        // worker threads, so all queue access goes through these.
+        void submit(const Queue& queue, const vk::SubmitInfo2& submitInfo, vk::Fence fence = nullptr) const;
+        vk::Result present(const vk::PresentInfoKHR& presentInfo) const;
+        void waitIdle() const;
+
         void submitImmediateCommands(
             const std::function<void(const vk::raii::CommandBuffer& commandBuffer)>& function
         ) const;
@@ -54,7 +83,16 @@ namespace yuubi {
         vk::raii::PhysicalDevice physicalDevice_ = nullptr;
         vk::raii::Device device_ = nullptr;
         Queue graphicsQueue_;
+        Queue transferQueue_;
+        vk::raii::Semaphore uploadTimeline_ = nullptr;
+        mutable uint64_t uploadTimelineValue_ = 0;
+        mutable std::mutex queueMutex_;
+        bool textureCompressionBC_ = false;
         std::shared_ptr<Allocator> allocator_ = nullptr;
+        // Declared after allocator_ so staging memory is released first.
+        std::shared_ptr<StagingAllocator> stagingAllocator_ = nullptr;
+        std::shared_ptr<MipGenerator> mipGenerator_ = nullptr;
+        std::shared_ptr<SamplerCache> samplerCache_ = nullptr;
 
         // Immediate Commands
         vk::raii::CommandPool immediateCommandPool_ = nullptr;
@@ -0,0 +1,47 @@
+#include "renderer/dynamic_buffer.h"
+#include "renderer/device.h"
+#include "renderer/viewport.h"
+
+namespace yuubi {
+
+    DynamicBuffer::DynamicBuffer(const Device& device, vk::DeviceSize slotSize, vk::BufferUsageFlags usage) {
+        // Keep slots aligned so any of them can be bound as a storage buffer as
+        // well as referenced by address.
+        const auto& limits = device.getPhysicalDevice().getProperties().limits;
+        const vk::DeviceSize alignment = std::max<vk::DeviceSize>(limits.minStorageBufferOffsetAlignment, 16);
+        slotStride_ = (slotSize + alignment - 1) / alignment * alignment;
+
+        const vk::BufferCreateInfo bufferCreateInfo{
+            .size = slotStride_ * Viewport::maxFramesInFlight,
+            .usage = usage | vk::BufferUsageFlagBits::eShaderDeviceAddress
+        };
+
+        // Prefer device-local memory that is also host visible (ReBAR) and fall
+        // back to host memory read over PCIe otherwise.
+        const VmaAllocationCreateInfo allocCreateInfo{
+            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+        };
+
+        buffer_ = device.createBuffer(bufferCreateInfo, allocCreateInfo);
+    }
+
+    DynamicBuffer& DynamicBuffer::operator=(DynamicBuffer&& rhs) noexcept {
+        if (this != &rhs) {
+            std::swap(buffer_, rhs.buffer_);
+            std::swap(slotStride_, rhs.slotStride_);
+        }
+
+        return *this;
+    }
+
+    void DynamicBuffer::write(uint32_t frameIndex, const void* data, size_t size, size_t offset) const {
+        assert(offset + size <= slotStride_);
+        buffer_.write(data, size, slotStride_ * frameIndex + offset);
+    }
+
+    vk::DeviceAddress DynamicBuffer::getAddress(uint32_t frameIndex) const {
+        return buffer_.getAddress() + slotStride_ * frameIndex;
+    }
+
+}
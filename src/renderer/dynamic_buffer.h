@@ -0,0 +1,43 @@
+#pragma once
+
+#include "core/util.h"
+#include "renderer/vulkan_usage.h"
+#include "renderer/vma/buffer.h"
+#include "pch.h"
+
+namespace yuubi {
+
+    class Device;
+
+    // Buffer for data rewritten by the CPU every frame. Holds one slot per
+    // frame in flight in persistently mapped (ReBAR when available) memory.
+    // Writes go straight to the mapping and slots are addressed through BDA,
+    // so no queue submission or fence wait is needed on the hot path.
+    //
+    // A slot must only be written once the fence of the frame that last used
+    // it has been waited on, i.e. from inside Viewport::doFrame.
+    class DynamicBuffer : NonCopyable {
+    public:
+        DynamicBuffer() = default;
+        DynamicBuffer(
+            const Device& device, vk::DeviceSize slotSize,
+            vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eStorageBuffer
+        );
+        DynamicBuffer(DynamicBuffer&&) = default;
+        DynamicBuffer& operator=(DynamicBuffer&& rhs) noexcept;
+
+        void write(uint32_t frameIndex, const void* data, size_t size, size_t offset = 0) const;
+
+        template<typename T>
+        void write(uint32_t frameIndex, const T& data) const {
+            write(frameIndex, &data, sizeof(T));
+        }
+
+        [[nodiscard]] vk::DeviceAddress getAddress(uint32_t frameIndex) const;
+
+    private:
+        Buffer buffer_;
+        vk::DeviceSize slotStride_ = 0;
+    };
+
+}
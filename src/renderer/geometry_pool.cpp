@@ -0,0 +1,132 @@
+#include "renderer/geometry_pool.h"
+#include "renderer/device.h"
+#include "renderer/upload_batcher.h"
+
+namespace yuubi {
+
+    GeometryPool::GeometryPool(std::shared_ptr<Device> device, uint32_t framesInFlight) :
+        device_(std::move(device)), framesInFlight_(framesInFlight) {}
+
+    std::optional<GeometryAllocation> GeometryPool::allocate(
+        UploadBatcher& batcher, const GeometryFormat& format, std::span<const std::byte> vertices,
+        std::span<const std::byte> indices
+    ) {
+        const auto allocation = [&]() -> std::optional<GeometryAllocation> {
+            std::lock_guard lock{mutex_};
+            for (uint32_t i = 0; i < numBlocks_; i++) {
+                if (auto result = allocateFromBlock(i, format, vertices.size(), indices.size())) {
+                    return result;
+                }
+            }
+
+            if (!createBlock(
+                    std::max<vk::DeviceSize>(vertices.size(), defaultVertexBlockSize),
+                    std::max<vk::DeviceSize>(indices.size(), defaultIndexBlockSize)
+                )) {
+                return std::nullopt;
+            }
+            return allocateFromBlock(numBlocks_ - 1, format, vertices.size(), indices.size()).value();
+        }();
+        if (!allocation.has_value()) {
+            return std::nullopt;
+        }
+
+        // Each upload only writes the allocated range, so blocks can be shared
+        // by meshes that are still being drawn.
+        const auto& target = block(allocation->block);
+        if (!vertices.empty()) {
+            batcher.uploadBuffer(target.vertexBuffer, vertices.data(), vertices.size(), allocation->vertexByteOffset);
+        }
+        if (!indices.empty()) {
+            batcher.uploadBuffer(target.indexBuffer, indices.data(), indices.size(), allocation->indexByteOffset);
+        }
+
+        return allocation;
+    }
+
+    void GeometryPool::free(const GeometryAllocation& allocation) {
+        std::lock_guard lock{mutex_};
+        pendingFrees_.push_back({.allocation = allocation, .frame = frame_});
+    }
+
+    void GeometryPool::nextFrame() {
+        std::lock_guard lock{mutex_};
+        frame_++;
+
+        // A range freed during frame n may be drawn by any frame recorded up
+        // to then, all of which have completed framesInFlight frames later.
+        std::erase_if(pendingFrees_, [this](const PendingFree& pending) {
+            if (pending.frame + framesInFlight_ > frame_) {
+                return false;
+            }
+
+            const auto& allocation = pending.allocation;
+            auto& target = *blocks_[allocation.block];
+            target.vertices.free(allocation.vertexByteOffset, allocation.vertexBytes);
+            target.indices.free(allocation.indexByteOffset, allocation.indexBytes);
+            return true;
+        });
+    }
+
+    std::optional<GeometryAllocation> GeometryPool::allocateFromBlock(
+        uint32_t block, const GeometryFormat& format, vk::DeviceSize vertexBytes, vk::DeviceSize indexBytes
+    ) {
+        auto& target = *blocks_[block];
+        if (target.vertices.freeSize() < vertexBytes || target.indices.freeSize() < indexBytes) {
+            return std::nullopt;
+        }
+
+        // Aligning each range to its stride keeps offsets whole numbers of
+        // vertices and indices.
+        const auto stride = vertexStride(format.vertexFormat);
+        const auto vertexByteOffset = vertexBytes > 0 ? target.vertices.allocate(vertexBytes, stride) : 0;
+        if (!vertexByteOffset.has_value()) {
+            return std::nullopt;
+        }
+        const auto size = indexSize(format.indexType);
+        const auto indexByteOffset = indexBytes > 0 ? target.indices.allocate(indexBytes, size) : 0;
+        if (!indexByteOffset.has_value()) {
+            target.vertices.free(*vertexByteOffset, vertexBytes);
+            return std::nullopt;
+        }
+
+        return GeometryAllocation{
+            .block = block,
+            .vertexOffset = static_cast<uint32_t>(*vertexByteOffset / stride),
+            .firstIndex = static_cast<uint32_t>(*indexByteOffset / size),
+            .vertexByteOffset = *vertexByteOffset,
+            .vertexBytes = vertexBytes,
+            .indexByteOffset = *indexByteOffset,
+            .indexBytes = indexBytes,
+        };
+    }
+
+    bool GeometryPool::createBlock(vk::DeviceSize vertexBytes, vk::DeviceSize indexBytes) {
+        if (numBlocks_ == maxBlocks) {
+            UB_ERROR("Geometry pool is full: all {} blocks are in use", maxBlocks);
+            return false;
+        }
+
+        constexpr VmaAllocationCreateInfo allocCreateInfo{.usage = VMA_MEMORY_USAGE_GPU_ONLY};
+        auto block = std::make_unique<Block>(Block{
+            .vertexBuffer = device_->createBuffer(
+                {.size = vertexBytes,
+                 .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst |
+                          vk::BufferUsageFlagBits::eShaderDeviceAddress},
+                allocCreateInfo
+            ),
+            .indexBuffer = device_->createBuffer(
+                {.size = indexBytes,
+                 .usage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst},
+                allocCreateInfo
+            ),
+            .vertices = RangeAllocator{vertexBytes},
+            .indices = RangeAllocator{indexBytes},
+        });
+
+        UB_INFO("Created geometry block {} of {} vertex and {} index bytes", numBlocks_, vertexBytes, indexBytes);
+        blocks_[numBlocks_++] = std::move(block);
+        return true;
+    }
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "core/range_allocator.h"
+#include "core/util.h"
+#include "renderer/vertex.h"
+#include "renderer/vma/buffer.h"
+#include "renderer/vulkan_usage.h"
+#include "pch.h"
+#include <mutex>
+
+namespace yuubi {
+
+    class Device;
+    class UploadBatcher;
+
+    // Place of a mesh's geometry in a GeometryPool.
+    struct GeometryAllocation {
+        uint32_t block = 0;
+        // In vertices and indices of the mesh's format from the start of the
+        // block's buffers, so they can be used as is for indexed draws.
+        uint32_t vertexOffset = 0;
+        uint32_t firstIndex = 0;
+        // Byte ranges in the block's buffers.
+        vk::DeviceSize vertexByteOffset = 0;
+        vk::DeviceSize vertexBytes = 0;
+        vk::DeviceSize indexByteOffset = 0;
+        vk::DeviceSize indexBytes = 0;
+    };
+
+    // Holds the vertices and indices of every mesh in a few large device-local
+    // buffers instead of a pair of buffers per mesh. Each block has a vertex
+    // buffer, read by shaders through its address, and an index buffer, and
+    // meshes are sub-allocated from them with a RangeAllocator. Meshes of
+    // different vertex formats and index types share blocks: each range is
+    // aligned to its own stride. Meshes larger than a block get a block of
+    // their own.
+    //
+    // Allocations are thread-safe. Freed ranges are only reused once the
+    // frames that may still draw them have completed; see nextFrame().
+    class GeometryPool : NonCopyableOrMovable {
+    public:
+        static constexpr uint32_t maxBlocks = 64;
+        static constexpr vk::DeviceSize defaultVertexBlockSize = 128ull * 1024 * 1024;
+        static constexpr vk::DeviceSize defaultIndexBlockSize = 32ull * 1024 * 1024;
+
+        struct Block {
+            Buffer vertexBuffer;
+            Buffer indexBuffer;
+            RangeAllocator vertices;
+            RangeAllocator indices;
+        };
+
+        GeometryPool(std::shared_ptr<Device> device, uint32_t framesInFlight);
+
+        // Allocates space for geometry encoded in format and records its
+        // upload. Returns nothing if every block is full and no more can be
+        // created.
+        [[nodiscard]] std::optional<GeometryAllocation> allocate(
+            UploadBatcher& batcher, const GeometryFormat& format, std::span<const std::byte> vertices,
+            std::span<const std::byte> indices
+        );
+        // Releases an allocation once no frame in flight can be drawing it.
+        void free(const GeometryAllocation& allocation);
+
+        // Must be called once per frame, after waiting for the oldest frame in
+        // flight to complete.
+        void nextFrame();
+
+        // Blocks are never destroyed or moved, so the returned reference stays
+        // valid for the lifetime of the pool.
+        [[nodiscard]] const Block& block(uint32_t index) const { return *blocks_[index]; }
+
+    private:
+        struct PendingFree {
+            GeometryAllocation allocation;
+            uint64_t frame;
+        };
+
+        [[nodiscard]] std::optional<GeometryAllocation> allocateFromBlock(
+            uint32_t block, const GeometryFormat& format, vk::DeviceSize vertexBytes, vk::DeviceSize indexBytes
+        );
+        bool createBlock(vk::DeviceSize vertexBytes, vk::DeviceSize indexBytes);
+
+        std::shared_ptr<Device> device_;
+        uint32_t framesInFlight_;
+
+        std::mutex mutex_;
+        // Fixed size so blocks published by the loader thread can be read by
+        // the render thread without taking the mutex.
+        std::array<std::unique_ptr<Block>, maxBlocks> blocks_;
+        uint32_t numBlocks_ = 0;
+        std::vector<PendingFree> pendingFrees_;
+        uint64_t frame_ = 0;
+    };
+
+}
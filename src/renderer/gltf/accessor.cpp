@@ -0,0 +1,314 @@
+#include "renderer/gltf/accessor.h"
+
+#include <fastgltf/tools.hpp>
+#if defined(__SSE2__) || defined(_M_X64)
+#define UB_ACCESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    using fastgltf::ComponentType;
+    using Float4 = std::array<float, 4>;
+
+    // Bytes of a buffer view from offset on, or nothing if fewer than size
+    // bytes are loaded there.
+    std::optional<const std::byte*> viewBytes(
+        const fastgltf::Asset& asset, size_t bufferView, size_t offset, size_t size
+    ) {
+        const auto bytes = fastgltf::DefaultBufferDataAdapter{}(asset, bufferView);
+        if (offset + size > bytes.size()) {
+            return std::nullopt;
+        }
+        return bytes.data() + offset;
+    }
+
+    // Loads the first components components of an element as floats. The
+    // rest are zero.
+    template<typename T, bool normalized>
+    Float4 loadElement(const std::byte* src, uint32_t components) {
+#ifdef UB_ACCESSOR_SSE2
+        if constexpr (std::is_integral_v<T> && sizeof(T) <= 2) {
+            // Components are widened to 32-bit lanes. Signed ones are unpacked
+            // into the top of each lane and shifted back down to extend the sign.
+            __m128i lanes;
+            if constexpr (sizeof(T) == 1) {
+                uint32_t word = 0;
+                std::memcpy(&word, src, components);
+                const auto packed = _mm_cvtsi32_si128(static_cast<int>(word));
+                if constexpr (std::is_signed_v<T>) {
+                    const auto shorts = _mm_unpacklo_epi8(packed, packed);
+                    lanes = _mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 24);
+                } else {
+                    const auto zero = _mm_setzero_si128();
+                    lanes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(packed, zero), zero);
+                }
+            } else {
+                uint64_t word = 0;
+                std::memcpy(&word, src, components * sizeof(T));
+                const auto packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&word));
+                if constexpr (std::is_signed_v<T>) {
+                    lanes = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+                } else {
+                    lanes = _mm_unpacklo_epi16(packed, _mm_setzero_si128());
+                }
+            }
+
+            auto values = _mm_cvtepi32_ps(lanes);
+            if constexpr (normalized) {
+                values = _mm_mul_ps(values, _mm_set1_ps(1.0f / static_cast<float>(std::numeric_limits<T>::max())));
+                if constexpr (std::is_signed_v<T>) {
+                    values = _mm_max_ps(values, _mm_set1_ps(-1.0f));
+                }
+            }
+
+            Float4 result;
+            _mm_storeu_ps(result.data(), values);
+            return result;
+        }
+#endif
+        if constexpr (std::is_same_v<T, float>) {
+            Float4 result{};
+            std::memcpy(result.data(), src, components * sizeof(float));
+            return result;
+        } else {
+            std::array<T, 4> components4{};
+            std::memcpy(components4.data(), src, components * sizeof(T));
+            Float4 result{};
+            for (uint32_t c = 0; c < 4; c++) {
+                result[c] = static_cast<float>(components4[c]);
+                if constexpr (normalized && std::is_integral_v<T>) {
+                    result[c] = std::max(result[c] / static_cast<float>(std::numeric_limits<T>::max()), -1.0f);
+                }
+            }
+            return result;
+        }
+    }
+
+    // Converts count elements srcStride bytes apart into target, at the
+    // element indices given by indices if there are any.
+    template<typename T, bool normalized>
+    void convertElements(
+        const std::byte* src, size_t srcStride, size_t count, uint32_t srcComponents,
+        const yuubi::AttributeTarget& target, const uint32_t* indices
+    ) {
+        const auto components = std::min(srcComponents, target.components);
+        bool contiguous = true;
+        for (uint32_t c = 1; c < components; c++) {
+            contiguous &= target.offsets[c] == target.offsets[0] + c * sizeof(float);
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            const auto element = loadElement<T, normalized>(src + i * srcStride, components);
+            auto* dst = target.base + (indices != nullptr ? indices[i] : i) * target.stride;
+            if (contiguous) {
+                std::memcpy(dst + target.offsets[0], element.data(), components * sizeof(float));
+            } else {
+                for (uint32_t c = 0; c < components; c++) {
+                    std::memcpy(dst + target.offsets[c], &element[c], sizeof(float));
+                }
+            }
+        }
+    }
+
+    void convertElements(
+        ComponentType componentType, bool normalized, const std::byte* src, size_t srcStride, size_t count,
+        uint32_t srcComponents, const yuubi::AttributeTarget& target, const uint32_t* indices
+    ) {
+        const auto convert = [&]<typename T>() {
+            if (normalized) {
+                convertElements<T, true>(src, srcStride, count, srcComponents, target, indices);
+            } else {
+                convertElements<T, false>(src, srcStride, count, srcComponents, target, indices);
+            }
+        };
+
+        switch (componentType) {
+            case ComponentType::Byte:
+                return convert.operator()<int8_t>();
+            case ComponentType::UnsignedByte:
+                return convert.operator()<uint8_t>();
+            case ComponentType::Short:
+                return convert.operator()<int16_t>();
+            case ComponentType::UnsignedShort:
+                return convert.operator()<uint16_t>();
+            case ComponentType::Int:
+                return convertElements<int32_t, false>(src, srcStride, count, srcComponents, target, indices);
+            case ComponentType::UnsignedInt:
+                return convertElements<uint32_t, false>(src, srcStride, count, srcComponents, target, indices);
+            case ComponentType::Float:
+                return convertElements<float, false>(src, srcStride, count, srcComponents, target, indices);
+            case ComponentType::Double:
+                return convertElements<double, false>(src, srcStride, count, srcComponents, target, indices);
+            default:
+                return;
+        }
+    }
+
+    // Widens count tightly packed indices of type T and adds base to them.
+    template<typename T>
+    void widenIndices(const std::byte* src, size_t count, uint32_t base, uint32_t* out) {
+        size_t i = 0;
+#ifdef UB_ACCESSOR_SSE2
+        const auto load = [&](size_t index) {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + index * sizeof(T)));
+        };
+        const auto store = [&](size_t index, __m128i lanes) {
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(out + index), _mm_add_epi32(lanes, _mm_set1_epi32(static_cast<int>(base)))
+            );
+        };
+        const auto zero = _mm_setzero_si128();
+
+        if constexpr (sizeof(T) == 1) {
+            for (; i + 16 <= count; i += 16) {
+                const auto bytes = load(i);
+                const auto low = _mm_unpacklo_epi8(bytes, zero);
+                const auto high = _mm_unpackhi_epi8(bytes, zero);
+                store(i, _mm_unpacklo_epi16(low, zero));
+                store(i + 4, _mm_unpackhi_epi16(low, zero));
+                store(i + 8, _mm_unpacklo_epi16(high, zero));
+                store(i + 12, _mm_unpackhi_epi16(high, zero));
+            }
+        } else if constexpr (sizeof(T) == 2) {
+            for (; i + 8 <= count; i += 8) {
+                const auto shorts = load(i);
+                store(i, _mm_unpacklo_epi16(shorts, zero));
+                store(i + 4, _mm_unpackhi_epi16(shorts, zero));
+            }
+        } else {
+            for (; i + 4 <= count; i += 4) {
+                store(i, load(i));
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            T index;
+            std::memcpy(&index, src + i * sizeof(T), sizeof(T));
+            out[i] = base + index;
+        }
+    }
+
+    bool widenIndices(ComponentType componentType, const std::byte* src, size_t count, uint32_t base, uint32_t* out) {
+        switch (componentType) {
+            case ComponentType::UnsignedByte:
+                widenIndices<uint8_t>(src, count, base, out);
+                return true;
+            case ComponentType::UnsignedShort:
+                widenIndices<uint16_t>(src, count, base, out);
+                return true;
+            case ComponentType::UnsignedInt:
+                widenIndices<uint32_t>(src, count, base, out);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+}
+
+namespace yuubi {
+
+    std::optional<size_t> convertAccessor(
+        const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, const AttributeTarget& target
+    ) {
+        const auto components = static_cast<uint32_t>(fastgltf::getNumComponents(accessor.type));
+        const auto elementSize = fastgltf::getElementByteSize(accessor.type, accessor.componentType);
+
+        // Everything is validated before anything is written.
+        const std::byte* dense = nullptr;
+        size_t denseStride = elementSize;
+        if (accessor.bufferViewIndex.has_value()) {
+            const auto& bufferView = asset.bufferViews[*accessor.bufferViewIndex];
+            denseStride = bufferView.byteStride.value_or(elementSize);
+            const auto size = accessor.count > 0 ? (accessor.count - 1) * denseStride + elementSize : 0;
+            const auto bytes = viewBytes(asset, *accessor.bufferViewIndex, accessor.byteOffset, size);
+            if (!bytes.has_value()) {
+                return std::nullopt;
+            }
+            dense = *bytes;
+        }
+
+        std::vector<uint32_t> sparseIndices;
+        const std::byte* sparseValues = nullptr;
+        if (accessor.sparse.has_value()) {
+            const auto& sparse = *accessor.sparse;
+            const auto indices = viewBytes(
+                asset, sparse.indicesBufferView, sparse.indicesByteOffset,
+                sparse.count * fastgltf::getComponentByteSize(sparse.indexComponentType)
+            );
+            const auto values =
+                viewBytes(asset, sparse.valuesBufferView, sparse.valuesByteOffset, sparse.count * elementSize);
+            if (!indices.has_value() || !values.has_value()) {
+                return std::nullopt;
+            }
+
+            sparseIndices.resize(sparse.count);
+            if (!widenIndices(sparse.indexComponentType, *indices, sparse.count, 0, sparseIndices.data()) ||
+                std::ranges::any_of(sparseIndices, [&](uint32_t index) { return index >= accessor.count; })) {
+                return std::nullopt;
+            }
+            sparseValues = *values;
+        }
+
+        size_t bytesRead = 0;
+        if (dense != nullptr) {
+            convertElements(
+                accessor.componentType, accessor.normalized, dense, denseStride, accessor.count, components, target,
+                nullptr
+            );
+            bytesRead += accessor.count * elementSize;
+        } else {
+            // Sparse accessors without a buffer view start out as zeros.
+            for (size_t i = 0; i < accessor.count; i++) {
+                for (uint32_t c = 0; c < std::min(components, target.components); c++) {
+                    std::memset(target.base + i * target.stride + target.offsets[c], 0, sizeof(float));
+                }
+            }
+        }
+
+        if (sparseValues != nullptr) {
+            convertElements(
+                accessor.componentType, accessor.normalized, sparseValues, elementSize, sparseIndices.size(),
+                components, target, sparseIndices.data()
+            );
+            bytesRead += sparseIndices.size() * (elementSize + fastgltf::getComponentByteSize(
+                                                                    accessor.sparse->indexComponentType
+                                                                ));
+        }
+
+        return bytesRead;
+    }
+
+    std::optional<size_t> convertIndices(
+        const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, std::span<uint32_t> out, uint32_t base
+    ) {
+        const auto indexSize = fastgltf::getComponentByteSize(accessor.componentType);
+
+        // Index buffer views can't be strided, but they can in principle be
+        // sparse. That is rare enough to leave to fastgltf.
+        if (accessor.sparse.has_value()) {
+            fastgltf::iterateAccessorWithIndex<uint32_t>(asset, accessor, [&](uint32_t index, size_t i) {
+                out[i] = base + index;
+            });
+            return accessor.count * indexSize;
+        }
+        if (!accessor.bufferViewIndex.has_value()) {
+            std::ranges::fill(out.first(accessor.count), base);
+            return 0;
+        }
+
+        const auto bytes = viewBytes(asset, *accessor.bufferViewIndex, accessor.byteOffset, accessor.count * indexSize);
+        if (!bytes.has_value() || !widenIndices(accessor.componentType, *bytes, accessor.count, base, out.data())) {
+            return std::nullopt;
+        }
+        return accessor.count * indexSize;
+    }
+
+    void rebaseIndices(std::span<const uint32_t> indices, uint32_t base, std::span<uint32_t> out) {
+        widenIndices<uint32_t>(
+            reinterpret_cast<const std::byte*>(indices.data()), indices.size(), base, out.data()
+        );
+    }
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "pch.h"
+#include <array>
+#include <fastgltf/types.hpp>
+
+// Bulk conversion of glTF accessors. Each accessor is read as a strided span of
+// its buffer and its component type is dispatched on once, instead of once per
+// element, so the inner loops are plain SIMD conversions.
+namespace yuubi {
+
+    // Where the components of a converted accessor go: component c of element i
+    // is written as a float at base + i * stride + offsets[c], which lets
+    // attributes be interleaved straight into a vertex struct.
+    struct AttributeTarget {
+        std::byte* base = nullptr;
+        size_t stride = 0;
+        std::array<size_t, 4> offsets{};
+        // Components of each element to write. Extra components of the
+        // accessor are dropped.
+        uint32_t components = 0;
+    };
+
+    // Builds a target for a float or glm vector member of each element of
+    // elements.
+    template<typename T, typename Member>
+    [[nodiscard]] AttributeTarget attributeTarget(std::span<T> elements, Member T::* member) {
+        constexpr uint32_t components = sizeof(Member) / sizeof(float);
+        AttributeTarget target{
+            .base = reinterpret_cast<std::byte*>(elements.data()),
+            .stride = sizeof(T),
+            .components = components,
+        };
+        const T probe{};
+        const auto offset = static_cast<size_t>(
+            reinterpret_cast<const std::byte*>(&(probe.*member)) - reinterpret_cast<const std::byte*>(&probe)
+        );
+        for (uint32_t c = 0; c < components; c++) {
+            target.offsets[c] = offset + c * sizeof(float);
+        }
+        return target;
+    }
+
+    // Converts every element of accessor to floats, honouring normalized
+    // integer components and sparse substitution, and writes them to target,
+    // which must hold accessor.count elements. Returns the number of bytes
+    // read from the asset's buffers, or nothing if the accessor's data isn't
+    // loaded, in which case target is left untouched.
+    std::optional<size_t> convertAccessor(
+        const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, const AttributeTarget& target
+    );
+
+    // Widens an index accessor into out, which must hold accessor.count
+    // indices, adding base to each index. Returns the number of bytes read, or
+    // nothing if the accessor's data isn't loaded.
+    std::optional<size_t> convertIndices(
+        const fastgltf::Asset& asset, const fastgltf::Accessor& accessor, std::span<uint32_t> out, uint32_t base = 0
+    );
+
+    // Writes indices + base to out, which must be at least as large as indices.
+    void rebaseIndices(std::span<const uint32_t> indices, uint32_t base, std::span<uint32_t> out);
+
+}
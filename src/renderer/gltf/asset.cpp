@@ -1,6 +1,12 @@
 #include "renderer/gltf/asset.h"
 
-#include "renderer/gltf/mikktspace.h"
+#include "core/hash.h"
+#include "core/io/mapped_file.h"
+#include "core/job_system.h"
+#include "renderer/gltf/cooked_asset.h"
+#include "renderer/gltf/mapped_gltf.h"
+#include "renderer/gltf/mesh_cache.h"
+#include "renderer/gltf/thread.h"
 #include "renderer/gpu_data.h"
 #include "renderer/loaded_gltf.h"
 #include "renderer/resources/resource_manager.h"
@@ -9,464 +15,714 @@
 #include "renderer/device.h"
 #include "renderer/resources/texture_manager.h"
 #include "renderer/resources/material_manager.h"
-#include <fastgltf/glm_element_traits.hpp>
+#include "renderer/sampler_cache.h"
+#include "renderer/upload_batcher.h"
+#include <chrono>
 #include <fastgltf/core.hpp>
 #include <fastgltf/types.hpp>
-#include <fastgltf/tools.hpp>
 #include <glm/glm.hpp>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/quaternion.hpp>
 #include "renderer/vulkan_usage.h"
 #include "renderer/vulkan/util.h"
-#include "renderer/gltf/thread.h"
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
 
 namespace {
 
-    std::unordered_set<std::size_t> getSrgbImageIndices(std::span<fastgltf::Material> materials) {
-        std::unordered_set<std::size_t> indices;
-
-        for (const auto& material: materials) {
-            if (const auto& baseColorTexture = material.pbrData.baseColorTexture) {
-                indices.emplace(baseColorTexture->textureIndex);
-            }
-            if (const auto& emissiveTexture = material.emissiveTexture) {
-                indices.emplace(emissiveTexture->textureIndex);
-            }
+    // Loaded geometry and textures are handed to the render thread in batches
+    // of roughly this size so they show up progressively.
+    constexpr vk::DeviceSize commitBytes = 32ull * 1024 * 1024;
+
+    // Vertex format glTF meshes are imported with. Compact vertices are less
+    // than half the size of full ones at the cost of quantized positions.
+    constexpr yuubi::VertexFormat meshVertexFormat = yuubi::VertexFormat::Compact;
+
+    // Runs load(i) for every i below count as a job of its own, so results can
+    // be consumed in order while later ones are still being produced. The
+    // jobs must be waited for before anything load references goes away;
+    // load itself is shared by the jobs, so it may be a temporary.
+    std::vector<yuubi::JobHandle> scheduleEach(size_t count, std::function<void(size_t)> load) {
+        auto& jobSystem = yuubi::JobSystem::get();
+        const auto sharedLoad = std::make_shared<const std::function<void(size_t)>>(std::move(load));
+        std::vector<yuubi::JobHandle> jobs;
+        jobs.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            jobs.push_back(jobSystem.schedule([sharedLoad, i] { (*sharedLoad)(i); }));
         }
-
-        return indices;
+        return jobs;
     }
 
-    vk::Format getImageFormat(int channels, bool srgb) {
-        switch (channels) {
-            case 1:
-                return vk::Format::eR8Unorm;
-            case 2:
-                return vk::Format::eR8G8Unorm;
-            case 3:
-            case 4:
-                return srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
-            default:
-                throw std::runtime_error{"Unsupported image channel"};
+    // Waits for every job before rethrowing the first exception one threw,
+    // since the others may still reference the caller's state.
+    void waitAll(std::span<const yuubi::JobHandle> jobs) {
+        std::exception_ptr exception;
+        for (const auto& job: jobs) {
+            try {
+                yuubi::JobSystem::get().wait(job);
+            } catch (...) {
+                if (exception == nullptr) {
+                    exception = std::current_exception();
+                }
+            }
+        }
+        if (exception != nullptr) {
+            std::rethrow_exception(exception);
         }
     }
 
-    // PERF: Load images in parallel with stb_image.
-    std::optional<yuubi::Image> loadImage(
-        yuubi::Device& device, const fastgltf::Asset& asset, const fastgltf::Image& image,
-        const std::filesystem::path& assetDir, bool srgb
-    ) {
-        std::optional<yuubi::Image> newImage;
-
-        int width, height, numChannels;
-
-        // Mostly taken from
-        // https://github.com/spnda/fastgltf/blob/main/examples/gl_viewer/gl_viewer.cpp
-        std::visit(
-            fastgltf::visitor{
-                [](auto&) {},
-                [&](const fastgltf::sources::URI& filePath) {
-                    assert(filePath.fileByteOffset == 0); // Byte offsets are unsupported.
-                    assert(filePath.uri.isLocalPath()); // Only local files are supported.
-
-                    const std::string pathString = (assetDir / filePath.uri.fspath()).string();
-                    unsigned char* data = stbi_load(pathString.c_str(), &width, &height, &numChannels, 0);
-                    if (data != nullptr) {
-                        newImage = createImageFromData(
-                            device, {.pixels = data,
-                                     .width = static_cast<uint32_t>(width),
-                                     .height = static_cast<uint32_t>(height),
-                                     .numChannels = static_cast<uint32_t>(numChannels),
-                                     .format = getImageFormat(numChannels, srgb)}
-                        );
-
-                        stbi_image_free(data);
-                    }
-                },
-                [&](const fastgltf::sources::Array& vector) {
-                    unsigned char* data = stbi_load_from_memory(
-                        reinterpret_cast<const unsigned char*>(vector.bytes.data()),
-                        static_cast<int>(vector.bytes.size()), &width, &height, &numChannels, 0
-                    );
+}
 
-                    if (data != nullptr) {
-                        newImage = createImageFromData(
-                            device, {.pixels = data,
-                                     .width = static_cast<uint32_t>(width),
-                                     .height = static_cast<uint32_t>(height),
-                                     .numChannels = 4,
-                                     .format = getImageFormat(numChannels, srgb)}
-                        );
+namespace yuubi {
 
-                        stbi_image_free(data);
-                    }
-                },
-                [&](const fastgltf::sources::BufferView& view) {
-                    auto& bufferView = asset.bufferViews[view.bufferViewIndex];
-                    auto& buffer = asset.buffers[bufferView.bufferIndex];
-
-                    std::visit(
-                        fastgltf::visitor{
-                            [](auto& arg) {},
-                            [&](const fastgltf::sources::Array& vector) {
-                                unsigned char* data = stbi_load_from_memory(
-                                    reinterpret_cast<const unsigned char*>(vector.bytes.data() + bufferView.byteOffset),
-                                    static_cast<int>(bufferView.byteLength), &width, &height, &numChannels, 4
-                                );
-                                if (data != nullptr) {
-                                    newImage = createImageFromData(
-                                        device, {.pixels = data,
-                                                 .width = static_cast<uint32_t>(width),
-                                                 .height = static_cast<uint32_t>(height),
-                                                 .numChannels = 4,
-                                                 .format = getImageFormat(numChannels, srgb)}
-                                    );
-
-                                    stbi_image_free(data);
-                                }
-                            }
-                        },
-                        buffer.data
-                    );
-                },
-            },
-            image.data
-        );
+    std::unique_ptr<GLTFAsset> GLTFAsset::loadAsync(
+        Device& device, GeometryPool& geometryPool, TextureManager& textureManager, MaterialManager& materialManager,
+        const std::filesystem::path& filePath
+    ) {
+        std::unique_ptr<GLTFAsset> asset{new GLTFAsset(device, geometryPool, textureManager, materialManager)};
+        asset->loader_ = std::jthread([asset = asset.get(), filePath](const std::stop_token& stopToken) {
+            // A failed load keeps whatever was committed before it failed.
+            try {
+                asset->load(stopToken, filePath);
+            } catch (const std::exception& e) {
+                UB_ERROR("Failed to load GLTF file {}: {}", filePath.string(), e.what());
+            } catch (...) {
+                UB_ERROR("Failed to load GLTF file {}", filePath.string());
+            }
+            asset->loading_ = false;
+        });
 
-        return newImage;
+        return asset;
     }
 
-    std::pair<vk::Filter, vk::SamplerMipmapMode> getSamplerFilterInfo(fastgltf::Filter filter) {
-        switch (filter) {
-            case fastgltf::Filter::Nearest:
-                return {vk::Filter::eNearest, vk::SamplerMipmapMode::eLinear};
-            case fastgltf::Filter::NearestMipMapNearest:
-                return {vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest};
-            case fastgltf::Filter::NearestMipMapLinear:
-                return {vk::Filter::eNearest, vk::SamplerMipmapMode::eLinear};
-
-            case fastgltf::Filter::Linear:
-                return {vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear};
-            case fastgltf::Filter::LinearMipMapNearest:
-                return {vk::Filter::eLinear, vk::SamplerMipmapMode::eNearest};
-            case fastgltf::Filter::LinearMipMapLinear:
-                return {vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear};
-
-            default:
-                return {vk::Filter::eNearest, vk::SamplerMipmapMode::eLinear};
+    GLTFAsset::GLTFAsset(
+        Device& device, GeometryPool& geometryPool, TextureManager& textureManager, MaterialManager& materialManager
+    ) :
+        device_(&device), geometryPool_(&geometryPool), textureManager_(&textureManager),
+        materialManager_(&materialManager) {}
+
+    GLTFAsset::~GLTFAsset() {
+        // The loader may still be acquiring textures.
+        loader_.request_stop();
+        if (loader_.joinable()) {
+            loader_.join();
+        }
+
+        for (const auto handle: acquiredTextures_) {
+            textureManager_->release(handle);
+        }
+        for (const auto handle: materialHandles_) {
+            materialManager_->removeResource(handle);
         }
     }
 
-}
+    void GLTFAsset::load(const std::stop_token& stopToken, const std::filesystem::path& filePath) {
+        UB_INFO("Loading GLTF file: {}", filePath.string());
 
-namespace yuubi {
+        // Uploads are recorded into batches. Each batch is handed to the
+        // render thread once it has been submitted.
+        UploadBatcher batcher(*device_);
 
-    GLTFAsset::GLTFAsset(
-        Device& device, TextureManager& textureManager, MaterialManager& materialManager,
-        const std::filesystem::path& filePath
+        const bool cooked = filePath.extension() == cookedAssetExtension;
+        if (!(cooked ? loadCooked(stopToken, batcher, filePath) : loadGltf(stopToken, batcher, filePath))) {
+            return;
+        }
+
+        post(batcher.flush(), [this, filePath](const vk::raii::CommandBuffer&) {
+            loaded_ = true;
+            UB_INFO("Loaded GLTF file: {}", filePath.string());
+        });
+    }
+
+    bool GLTFAsset::loadGltf(
+        const std::stop_token& stopToken, UploadBatcher& batcher, const std::filesystem::path& filePath
     ) {
-        UB_INFO("Loading GLTF file: {}", filePath.string());
+        const auto gltf = MappedGltf::load(filePath);
+        if (!gltf.has_value()) {
+            return false;
+        }
+        const auto& asset = gltf->asset();
 
-        fastgltf::Parser parser;
+        UB_INFO("Loading materials...");
+        const auto materials = importMaterials(asset);
+        UB_INFO("Done loading materials...");
 
-        auto data = fastgltf::GltfDataBuffer::FromPath(filePath.string());
-        if (data.error() != fastgltf::Error::None) {
-            UB_ERROR("Unable to load file: {}", filePath.string());
-            // TODO: throw
+        // Meshes and nodes come from the mesh cache if this file has been
+        // imported before.
+        const auto cachePath = meshCachePath(filePath, asset, meshVertexFormat);
+        auto cached = std::filesystem::exists(cachePath) ? readCookedAsset(cachePath) : std::nullopt;
+        if (cached.has_value() && cached->meshes.size() != asset.meshes.size()) {
+            cached.reset();
         }
 
-        constexpr auto gltfOptions = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::AllowDouble |
-                                     fastgltf::Options::LoadExternalBuffers;
-        auto loadedGltf = parser.loadGltf(data.get(), filePath.parent_path(), gltfOptions);
-        if (auto error = loadedGltf.error(); error != fastgltf::Error::None) {
-            UB_ERROR("Unable to parse file: {}", filePath.string());
-            // TODO: throw
+        auto nodes = cached.has_value() ? std::move(cached->nodes) : importNodes(asset);
+        const auto meshNames =
+            cached.has_value()
+                ? cached->meshes | std::views::transform([](const auto& mesh) { return std::string(mesh.name); }) |
+                      std::ranges::to<std::vector>()
+                : asset.meshes |
+                      std::views::transform([](const auto& mesh) { return std::string(mesh.name.c_str()); }) |
+                      std::ranges::to<std::vector>();
+        const auto meshes = publishScene(materials, nodes, meshNames, asset.textures.size());
+
+        // Meshes are imported in parallel on the job system and uploaded in
+        // order as they finish, so uploads overlap with the remaining imports.
+        // Imported meshes are kept until they have been written to the cache.
+        std::vector<ImportedMesh> importedMeshes(cached.has_value() ? 0 : asset.meshes.size());
+        const auto importStart = std::chrono::steady_clock::now();
+        std::vector importEnds(importedMeshes.size(), importStart);
+        const auto importMeshAt = [&](size_t i) {
+            if (!stopToken.stop_requested()) {
+                importedMeshes[i] = importMesh(asset, asset.meshes[i], materials, meshVertexFormat);
+                importEnds[i] = std::chrono::steady_clock::now();
+            }
+        };
+        const auto importJobs = scheduleEach(importedMeshes.size(), importMeshAt);
+
+        // A failed import leaves its mesh empty. The failure is only rethrown
+        // once every job is done, since the others still write into locals.
+        const bool meshesUploaded = uploadMeshes(stopToken, batcher, meshes, [&](size_t i) -> MeshView {
+            if (cached.has_value()) {
+                return cached->meshes[i];
+            }
+            try {
+                JobSystem::get().wait(importJobs[i]);
+            } catch (...) {
+                return {};
+            }
+            return importedMeshes[i].view();
+        });
+        // The jobs reference locals, so they must finish even if loading was
+        // cancelled.
+        waitAll(importJobs);
+        if (!meshesUploaded) {
+            return false;
         }
-        auto asset = std::move(loadedGltf.get());
 
-        // Check sRGB preference.
-        auto srgbImageIndices = getSrgbImageIndices(asset.materials);
+        if (!importedMeshes.empty()) {
+            const auto megabytes =
+                static_cast<double>(std::ranges::fold_left(
+                    importedMeshes | std::views::transform(&ImportedMesh::sourceBytes), 0uz, std::plus{}
+                )) /
+                (1024 * 1024);
+            const auto seconds = std::chrono::duration<double>(std::ranges::max(importEnds) - importStart).count();
+            UB_INFO(
+                "Imported {} meshes from {:.1f} MB of accessors in {:.2f}s ({:.1f} MB/s)", importedMeshes.size(),
+                megabytes, seconds, megabytes / seconds
+            );
+        }
 
+        if (!cached.has_value() && !cachePath.empty()) {
+            writeMeshCache(cachePath, importedMeshes, std::move(nodes));
+        }
 
-        // TODO: handle missing images by replacing with error checkerboard
-        // PERF: Horrendously slow. MUST FIX.
+        // Images are hashed up front, so ones that are already resident, from
+        // this or another asset, are neither decoded nor uploaded again. The
+        // rest are decoded on the job system and each one is uploaded as soon
+        // as it is ready, so decoding overlaps with uploads.
         UB_INFO("Loading textures...");
-
-        auto imageDatas = loadTextures(asset, filePath.parent_path());
-        for (const auto& [i, fastgltfTexture]: std::views::enumerate(asset.textures)) {
-            // Create image.
-            const auto& imageData = imageDatas[i];
-            auto image = createImageFromData(
-                device,
-                ImageData{
-                    .pixels = imageData.data(),
-                    .width = imageData.width(),
-                    .height = imageData.height(),
-                    .numChannels = imageData.numChannels(),
-                    .format = imageData.format()
+        const auto roles = getImageRoles(asset);
+        std::vector<uint64_t> hashes(asset.images.size());
+        JobSystem::get().parallelFor(hashes.size(), [&](size_t i) {
+            if (roles[i].has_value()) {
+                hashes[i] = hashImage(asset, i, filePath.parent_path());
+            }
+        });
+
+        const bool blockCompression = device_->supportsBlockCompression();
+
+        // Images found in the cache are skipped, but the cached texture may
+        // be released before the upload gets to them. They are decoded on the
+        // loader thread then.
+        std::vector<TextureImageData> imageDatas(asset.images.size());
+        std::vector<uint8_t> skippedImages(asset.images.size());
+        const auto decodeImage = [&](size_t i) {
+            if (stopToken.stop_requested() || !roles[i].has_value()) {
+                return;
+            }
+            if (textureManager_->findCachedImage(hashes[i], *roles[i]) != nullptr) {
+                skippedImages[i] = true;
+                return;
+            }
+            imageDatas[i] = loadImage(asset, i, filePath.parent_path(), *roles[i], blockCompression);
+        };
+        const auto decodeJobs = scheduleEach(imageDatas.size(), decodeImage);
+
+        // Images that fail to decode keep the error texture. Failures are
+        // rethrown once every decode job is done.
+        std::exception_ptr decodeError;
+
+        const auto textureImages =
+            std::views::iota(0uz, asset.textures.size()) |
+            std::views::transform([&asset](size_t i) { return getTextureImage(asset, i); }) |
+            std::ranges::to<std::vector>();
+        const auto textureKeys = std::views::zip(asset.textures, textureImages) |
+                                 std::views::transform([&](const auto& texture) {
+                                     const auto& [gltfTexture, image] = texture;
+                                     return TextureKey{
+                                         .contentHash = hashes[image],
+                                         .role = *roles[image],
+                                         .sampler = importSampler(asset, gltfTexture),
+                                     };
+                                 }) |
+                                 std::ranges::to<std::vector>();
+        const bool texturesUploaded = uploadTextures(
+            stopToken, batcher, textureKeys, textureImages, imageDatas.size(),
+            [&](size_t i) {
+                try {
+                    JobSystem::get().wait(decodeJobs[i]);
+                    if (skippedImages[i]) {
+                        imageDatas[i] = loadImage(asset, i, filePath.parent_path(), *roles[i], blockCompression);
+                    }
+                } catch (...) {
+                    if (decodeError == nullptr) {
+                        decodeError = std::current_exception();
+                    }
+                    return SourceImage{};
                 }
-            );
+                return SourceImage{std::visit([](const auto& data) { return data.imageData(); }, imageDatas[i])};
+            },
+            [&](size_t i) { imageDatas[i] = {}; }
+        );
+        waitAll(decodeJobs);
+        if (decodeError != nullptr) {
+            std::rethrow_exception(decodeError);
+        }
+        if (!texturesUploaded) {
+            return false;
+        }
+        UB_INFO("Done loading textures...");
 
-            // Create image view.
-            auto imageView = device.createImageView(
-                *image.getImage(), image.getImageFormat(), vk::ImageAspectFlagBits::eColor, image.getMipLevels()
-            );
+        return true;
+    }
 
-            // Create sampler.
-            const auto& gltfSampler = asset.samplers.at(fastgltfTexture.samplerIndex.value());
-            auto [minFilter, minMipmapMode] =
-                getSamplerFilterInfo(gltfSampler.minFilter.value_or(fastgltf::Filter::Nearest));
-            auto [magFilter, _] = getSamplerFilterInfo(gltfSampler.magFilter.value_or(fastgltf::Filter::Nearest));
-
-            auto sampler = device.getDevice().createSampler(vk::SamplerCreateInfo{
-                .magFilter = magFilter,
-                .minFilter = minFilter,
-                .mipmapMode = minMipmapMode,
-                .anisotropyEnable = vk::True,
-                .maxAnisotropy = device.getPhysicalDevice().getProperties2().properties.limits.maxSamplerAnisotropy,
-                .minLod = 0,
-                .maxLod = static_cast<float>(image.getMipLevels()),
-            });
+    bool GLTFAsset::loadCooked(
+        const std::stop_token& stopToken, UploadBatcher& batcher, const std::filesystem::path& filePath
+    ) {
+        auto cooked = readCookedAsset(filePath);
+        if (!cooked.has_value()) {
+            return false;
+        }
 
-            auto texture = std::make_shared<Texture>(std::move(image), std::move(imageView), std::move(sampler));
-            textureManager.addResource(texture);
+        const auto meshes = publishScene(
+            cooked->materials, cooked->nodes,
+            cooked->meshes | std::views::transform([](const auto& mesh) { return std::string(mesh.name); }) |
+                std::ranges::to<std::vector>(),
+            cooked->textures.size()
+        );
+
+        const bool meshesUploaded =
+            uploadMeshes(stopToken, batcher, meshes, [&cooked](size_t i) { return cooked->meshes[i]; });
+        if (!meshesUploaded) {
+            return false;
         }
-        UB_INFO("Done loading textures...");
 
-        UB_INFO("Loading materials...");
-        auto materials =
-            asset.materials | std::views::transform([](const fastgltf::Material& fastgltfMaterial) {
-                // TODO: get more texture data
+        // Cooked images are stored in their final format with their mip
+        // chain, so loading them only takes reading the files. Textures that
+        // share a file share the image.
+        UB_INFO("Loading textures...");
+        std::vector<std::filesystem::path> imagePaths;
+        std::vector<size_t> textureImages;
+        for (const auto& texture: cooked->textures) {
+            auto it = std::ranges::find(imagePaths, texture.image);
+            if (it == imagePaths.end()) {
+                it = imagePaths.insert(it, texture.image);
+            }
+            textureImages.push_back(std::distance(imagePaths.begin(), it));
+        }
 
-                auto getTextureIndex = [](const std::optional<fastgltf::TextureInfo>& textureInfo) -> uint32_t {
-                    if (!textureInfo.has_value()) {
-                        return 0;
-                    }
+        std::vector<uint64_t> hashes(imagePaths.size());
+        JobSystem::get().parallelFor(hashes.size(), [&](size_t i) {
+            const MappedFile file(filePath.parent_path() / imagePaths[i]);
+            hashes[i] = hashBytes(file.bytes());
+        });
+
+        // Images found in the cache are skipped, and read on the loader
+        // thread if the cached texture is released before their upload.
+        std::vector<KtxImageData> imageDatas(imagePaths.size());
+        std::vector<uint8_t> skippedImages(imagePaths.size());
+        const auto readImageAt = [&](size_t i) {
+            const MappedFile file(filePath.parent_path() / imagePaths[i]);
+            if (!file.isOpen()) {
+                return;
+            }
 
-                    return textureInfo->textureIndex + 1;
+            const auto bytes = file.bytes();
+            imageDatas[i] = KtxImageData(
+                {reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size()}, TextureRole::Color,
+                device_->supportsBlockCompression()
+            );
+        };
+        const auto readImage = [&](size_t i) {
+            if (stopToken.stop_requested()) {
+                return;
+            }
+            if (textureManager_->findCachedImage(hashes[i], TextureRole::Color) != nullptr) {
+                skippedImages[i] = true;
+                return;
+            }
+            readImageAt(i);
+        };
+        const auto readJobs = scheduleEach(imageDatas.size(), readImage);
+        std::exception_ptr readError;
+
+        // Cooked images carry their format, so they are all keyed as color,
+        // the role they are read with.
+        const auto textureKeys = std::views::zip(cooked->textures, textureImages) |
+                                 std::views::transform([&hashes](const auto& texture) {
+                                     const auto& [cookedTexture, image] = texture;
+                                     return TextureKey{
+                                         .contentHash = hashes[image],
+                                         .role = TextureRole::Color,
+                                         .sampler = cookedTexture.sampler,
+                                     };
+                                 }) |
+                                 std::ranges::to<std::vector>();
+        const bool texturesUploaded = uploadTextures(
+            stopToken, batcher, textureKeys, textureImages, imageDatas.size(),
+            [&](size_t i) {
+                // As for glTF images, failures wait for the other jobs.
+                try {
+                    JobSystem::get().wait(readJobs[i]);
+                    if (skippedImages[i]) {
+                        readImageAt(i);
+                    }
+                } catch (...) {
+                    if (readError == nullptr) {
+                        readError = std::current_exception();
+                    }
+                    return SourceImage{};
+                }
+                return SourceImage{
+                    .data = imageDatas[i].imageData(),
+                    .streamingPath = filePath.parent_path() / imagePaths[i],
                 };
+            },
+            [&](size_t i) { imageDatas[i] = {}; }
+        );
+        waitAll(readJobs);
+        if (readError != nullptr) {
+            std::rethrow_exception(readError);
+        }
+        if (!texturesUploaded) {
+            return false;
+        }
+        UB_INFO("Done loading textures...");
 
-                auto normalTextureIndex =
-                    fastgltfMaterial.normalTexture.transform([](const auto& texture) { return texture.textureIndex; }
-                    ).value_or(-1) +
-                    1;
-
-                auto normalScale =
-                    fastgltfMaterial.normalTexture.transform([](const auto& texture) { return texture.scale; }
-                    ).value_or(1);
+        return true;
+    }
 
-                // PERF: Ignore alphaCutoff in other modes.
-                auto alphaCutoff =
-                    fastgltfMaterial.alphaMode == fastgltf::AlphaMode::Mask ? fastgltfMaterial.alphaCutoff : 1.0;
+    std::vector<std::shared_ptr<Mesh>> GLTFAsset::publishScene(
+        std::span<const ImportedMaterial> importedMaterials, std::span<const ImportedNode> importedNodes,
+        std::span<const std::string> meshNames, size_t numTextures
+    ) {
+        // Meshes are filled in as their geometry becomes resident. Until then
+        // they have no surfaces and draw nothing.
+        std::vector<std::shared_ptr<Mesh>> meshes;
+        std::unordered_map<std::string, std::shared_ptr<Mesh>> namedMeshes;
+        for (const auto& name: meshNames) {
+            const auto& mesh = meshes.emplace_back(std::make_shared<Mesh>());
+            namedMeshes[name] = mesh;
+        }
 
-                return std::make_shared<yuubi::MaterialData>(
-                    normalTextureIndex, normalScale,
+        std::vector<std::shared_ptr<Node>> nodes;
+        std::unordered_map<std::string, std::shared_ptr<Node>> namedNodes;
+        std::vector<std::shared_ptr<Node>> topNodes;
 
-                    getTextureIndex(fastgltfMaterial.pbrData.baseColorTexture), 0,
-                    glm::vec4{
-                        fastgltfMaterial.pbrData.baseColorFactor.x(), fastgltfMaterial.pbrData.baseColorFactor.y(),
-                        fastgltfMaterial.pbrData.baseColorFactor.z(), fastgltfMaterial.pbrData.baseColorFactor.w()
-                    },
+        for (const auto& importedNode: importedNodes) {
+            std::shared_ptr<Node> newNode;
 
-                    getTextureIndex(fastgltfMaterial.pbrData.metallicRoughnessTexture),
-                    fastgltfMaterial.pbrData.metallicFactor, fastgltfMaterial.pbrData.roughnessFactor, alphaCutoff
-                );
-            });
+            if (importedNode.mesh.has_value()) {
+                newNode = std::make_shared<MeshNode>(meshes[*importedNode.mesh]);
+            } else {
+                newNode = std::make_shared<Node>();
+            }
+            newNode->localTransform = importedNode.localTransform;
 
-        for (auto&& material: materials) {
-            materialManager.addResource(material);
+            nodes.push_back(newNode);
+            namedNodes[importedNode.name] = newNode;
         }
 
-        // PERF: do in one pass
-        auto transparentMaterialIndices = asset.materials | std::views::enumerate | std::views::filter([](auto&& pair) {
-                                              const auto& [i, material] = pair;
-                                              return material.alphaMode == fastgltf::AlphaMode::Blend;
-                                          }) |
-                                          std::views::transform([](auto&& pair) {
-                                              const auto& [i, _] = pair;
-                                              return i;
-                                          }) |
-                                          std::ranges::to<std::unordered_set>();
-        UB_INFO("Done loading materials...");
+        for (const auto& [importedNode, sceneNode]: std::views::zip(importedNodes, nodes)) {
+            for (const auto childIndex: importedNode.children) {
+                auto& childNode = nodes[childIndex];
+                sceneNode->children.push_back(childNode);
+                childNode->parent = sceneNode;
+            }
+        }
 
-        std::vector<std::shared_ptr<Mesh>> meshes;
-        std::vector<uint32_t> indices;
-        std::vector<Vertex> vertices;
+        for (auto& node: nodes) {
+            if (node->parent.lock() == nullptr) {
+                topNodes.push_back(node);
+                node->refreshTransform(glm::mat4{1.0f});
+            }
+        }
 
-        bool hasTangents = false;
+        // Textures start out as the error texture and are filled in by
+        // updateMaterials() as they become resident.
+        auto materials = importedMaterials | std::views::transform([](const auto& material) {
+                             return std::make_shared<MaterialData>(material.data);
+                         }) |
+                         std::ranges::to<std::vector>();
+        auto materialTextures =
+            importedMaterials | std::views::transform(&ImportedMaterial::textures) | std::ranges::to<std::vector>();
+
+        // glTF's default material, used by primitives without one. Surfaces
+        // index it after the asset's own materials, so they never reach into
+        // another asset's slots, even if the asset has no materials.
+        materials.push_back(std::make_shared<MaterialData>(0, 1.0f, 0, 0, glm::vec4{1.0f}, 0, 1.0f, 1.0f, 1.0f));
+        materialTextures.emplace_back();
+
+        // Publish the scene structure straight away.
+        post(
+            0,
+            [this, materials = std::move(materials), materialTextures = std::move(materialTextures), numTextures,
+             namedMeshes = std::move(namedMeshes), namedNodes = std::move(namedNodes),
+             topNodes = std::move(topNodes)](const vk::raii::CommandBuffer& commandBuffer) mutable {
+                materials_ = std::move(materials);
+                materialTextures_ = std::move(materialTextures);
+                materialHandles_ = materialManager_->addResources(materials_, commandBuffer);
+                textureHandles_.assign(numTextures, 0);
+
+                meshes_ = std::move(namedMeshes);
+                nodes_ = std::move(namedNodes);
+                topNodes_ = std::move(topNodes);
+            }
+        );
 
-        for (const fastgltf::Mesh& mesh: asset.meshes) {
-            indices.clear();
-            vertices.clear();
+        return meshes;
+    }
 
-            std::vector<GeoSurface> primitives;
+    bool GLTFAsset::uploadMeshes(
+        const std::stop_token& stopToken, UploadBatcher& batcher, std::span<const std::shared_ptr<Mesh>> meshes,
+        const std::function<MeshView(size_t)>& getMesh
+    ) {
+        std::vector<std::pair<std::shared_ptr<Mesh>, Mesh>> loadedMeshes;
+        const auto commitMeshes = [&] {
+            const auto timelineValue = batcher.flush();
+            post(
+                timelineValue,
+                [loadedMeshes = std::exchange(loadedMeshes, {})](const vk::raii::CommandBuffer&) mutable {
+                    for (auto& [target, mesh]: loadedMeshes) {
+                        *target = std::move(mesh);
+                    }
+                }
+            );
+        };
 
-            for (auto&& primitive: mesh.primitives) {
-                yuubi::GeoSurface newPrimitive{
-                    .startIndex = static_cast<uint32_t>(indices.size()),
-                    .count = static_cast<uint32_t>(asset.accessors[primitive.indicesAccessor.value()].count)
-                };
+        for (const auto& [i, target]: std::views::enumerate(meshes)) {
+            if (stopToken.stop_requested()) {
+                return false;
+            }
 
-                size_t initial_vertex = vertices.size();
+            const auto mesh = getMesh(i);
+            if (mesh.surfaces.empty()) {
+                // Nothing to draw, or the mesh failed to import.
+                continue;
+            }
+            const auto geometry = geometryPool_->allocate(batcher, mesh.format, mesh.vertices, mesh.indices);
+            if (!geometry.has_value()) {
+                // Meshes uploaded so far are kept and drawn.
+                UB_ERROR("Out of geometry pool space for mesh {}", mesh.name);
+                commitMeshes();
+                return false;
+            }
+            loadedMeshes.emplace_back(
+                target, Mesh(
+                            std::string(mesh.name), *geometryPool_, *geometry, mesh.format,
+                            std::vector(mesh.surfaces.begin(), mesh.surfaces.end())
+                        )
+            );
+            if (batcher.pendingBytes() >= commitBytes) {
+                commitMeshes();
+            }
+        }
+        commitMeshes();
 
-                // Load indices.
-                {
-                    const fastgltf::Accessor& indexAccessor = asset.accessors[primitive.indicesAccessor.value()];
-                    indices.reserve(indices.size() + indexAccessor.count);
+        return true;
+    }
 
-                    for (uint32_t index: fastgltf::iterateAccessor<uint32_t>(asset, indexAccessor)) {
-                        indices.push_back(initial_vertex + index);
+    bool GLTFAsset::uploadTextures(
+        const std::stop_token& stopToken, UploadBatcher& batcher, std::span<const TextureKey> textureKeys,
+        std::span<const size_t> textureImages, size_t numImages, const std::function<SourceImage(size_t)>& getImage,
+        const std::function<void(size_t)>& releaseImage
+    ) {
+        std::vector<std::tuple<size_t, TextureKey, std::shared_ptr<Texture>>> loadedTextures;
+        std::vector<std::pair<size_t, ResourceHandle>> cachedTextures;
+        struct StreamedTexture {
+            size_t textureIndex;
+            TextureKey key;
+            std::shared_ptr<const TextureImage> image;
+            StreamingSource source;
+            uint32_t firstMip;
+        };
+        std::vector<StreamedTexture> streamedTextures;
+        const auto commitTextures = [&] {
+            const auto timelineValue = batcher.flush();
+            post(
+                timelineValue,
+                [this, loadedTextures = std::exchange(loadedTextures, {}),
+                 cachedTextures = std::exchange(cachedTextures, {}),
+                 streamedTextures = std::exchange(streamedTextures, {})](const vk::raii::CommandBuffer& commandBuffer) {
+                    for (const auto& [i, key, texture]: loadedTextures) {
+                        // Materials keep sampling the error texture if there
+                        // is no room for it.
+                        const auto handle = textureManager_->addCached(key, texture);
+                        if (!handle.has_value()) {
+                            continue;
+                        }
+                        textureHandles_[i] = *handle;
+                        std::lock_guard lock(commitMutex_);
+                        acquiredTextures_.push_back(*handle);
                     }
-                }
-
-                // Load vertex positions.
-                {
-                    const auto* positionIter = primitive.findAttribute("POSITION");
-                    const auto& positionAccessor = asset.accessors[positionIter->accessorIndex];
-
-                    vertices.resize(vertices.size() + positionAccessor.count);
-
-                    fastgltf::iterateAccessorWithIndex<glm::vec3>(
-                        asset, positionAccessor,
-                        [&](glm::vec3 vertex, size_t index) {
-                            vertices[initial_vertex + index] = yuubi::Vertex{
-                                .position = vertex,
-                                .uv_x = 0,
-                                .normal = {1.0f, 0.0f, 0.0f},
-                                .uv_y = 0,
-                                .color = glm::vec4{1.0f},
-                            };
+                    for (const auto& streamed: streamedTextures) {
+                        // Another load may have cached the texture first with
+                        // an image of its own.
+                        if (textureManager_->findCachedImage(streamed.key.contentHash, streamed.key.role) ==
+                            streamed.image) {
+                            textureManager_->stream(
+                                textureHandles_[streamed.textureIndex], streamed.source, streamed.firstMip
+                            );
                         }
-                    );
-                }
-
-                // Load normals.
-                {
-                    const auto* normalIter = primitive.findAttribute("NORMAL");
-                    if (normalIter != primitive.attributes.end()) {
-                        fastgltf::iterateAccessorWithIndex<glm::vec3>(
-                            asset, asset.accessors[(*normalIter).accessorIndex],
-                            [&](glm::vec3 normal, size_t index) { vertices[initial_vertex + index].normal = normal; }
-                        );
                     }
+                    for (const auto& [i, handle]: cachedTextures) {
+                        textureHandles_[i] = handle;
+                    }
+                    updateMaterials(commandBuffer);
                 }
+            );
+        };
 
-                // Load UVs.
-                // TODO: support all texcoords
-                {
-                    const auto* texCoordIter = primitive.findAttribute("TEXCOORD_0");
-                    if (texCoordIter != primitive.attributes.end()) {
-                        fastgltf::iterateAccessorWithIndex<glm::vec2>(
-                            asset, asset.accessors[(*texCoordIter).accessorIndex],
-                            [&](glm::vec2 uv, size_t index) {
-                                vertices[initial_vertex + index].uv_x = uv.x;
-                                vertices[initial_vertex + index].uv_y = uv.y;
-                            }
-                        );
-                    }
+        std::vector<std::vector<size_t>> imageTextures(numImages);
+        for (const auto& [textureIndex, imageIndex]: std::views::enumerate(textureImages)) {
+            imageTextures[imageIndex].push_back(textureIndex);
+        }
+
+        for (const auto& [i, textures]: std::views::enumerate(imageTextures)) {
+            if (stopToken.stop_requested()) {
+                return false;
+            }
+
+            // Textures that are already resident are used as they are.
+            std::vector<size_t> missingTextures;
+            for (const auto textureIndex: textures) {
+                if (const auto handle = textureManager_->acquireCached(textureKeys[textureIndex])) {
+                    cachedTextures.emplace_back(textureIndex, *handle);
+                    std::lock_guard lock(commitMutex_);
+                    acquiredTextures_.push_back(*handle);
+                } else {
+                    missingTextures.push_back(textureIndex);
                 }
+            }
+            if (missingTextures.empty()) {
+                continue;
+            }
 
-                // Load colors.
-                {
-                    const auto* colorIter = primitive.findAttribute("COLOR_0");
-                    if (colorIter != primitive.attributes.end()) {
-                        fastgltf::iterateAccessorWithIndex<glm::vec4>(
-                            asset, asset.accessors[(*colorIter).accessorIndex],
-                            [&](glm::vec4 color, size_t index) { vertices[initial_vertex + index].color = color; }
-                        );
-                    }
+            // The rest share the image of a resident texture with another
+            // sampler if there is one, and upload it otherwise.
+            const auto& key = textureKeys[missingTextures.front()];
+            auto textureImage = textureManager_->findCachedImage(key.contentHash, key.role);
+            std::optional<std::pair<StreamingSource, uint32_t>> streaming;
+            if (textureImage == nullptr) {
+                // Create image. Its pixels are in staging memory afterwards.
+                const auto [imageData, streamingPath] = getImage(i);
+                if (imageData.pixels == nullptr) {
+                    // Materials keep sampling the error texture.
+                    UB_ERROR("Unable to load image {}", i);
+                    continue;
                 }
 
-                // Load tangents.
-                {
-                    const auto* tangentIter = primitive.findAttribute("TANGENT");
-                    if (tangentIter != primitive.attributes.end()) {
-                        fastgltf::iterateAccessorWithIndex<glm::vec4>(
-                            asset, asset.accessors[(*tangentIter).accessorIndex],
-                            [&](glm::vec4 tangent, size_t index) { vertices[initial_vertex + index].tangent = tangent; }
+                // Streamed images start out with only their mip tail. The
+                // TextureManager brings finer levels in as they are sampled.
+                auto uploadData = imageData;
+                if (!streamingPath.empty() && !imageData.mipLevels.empty()) {
+                    const auto tailMip = TextureManager::streamingTailMip(
+                        imageData.width, imageData.height, static_cast<uint32_t>(imageData.mipLevels.size())
+                    );
+                    if (tailMip > 0) {
+                        streaming.emplace(
+                            StreamingSource{
+                                .path = streamingPath,
+                                .levelSizes = imageData.mipLevels | std::views::transform(&ImageMipLevel::size) |
+                                              std::ranges::to<std::vector>(),
+                            },
+                            tailMip
                         );
-                        hasTangents = true;
+                        uploadData = mipTail(imageData, tailMip);
                     }
                 }
 
-                // Load material index
-                newPrimitive.materialIndex = primitive.materialIndex.value_or(0);
-                newPrimitive.passType = transparentMaterialIndices.contains(newPrimitive.materialIndex)
-                                            ? MaterialPass::Transparent
-                                            : MaterialPass::Opaque;
-
-                primitives.push_back(newPrimitive);
+                auto image = batcher.createImage(uploadData);
+                releaseImage(i);
+                if (!image.isAllocated()) {
+                    UB_ERROR("Out of device memory for image {}", i);
+                    continue;
+                }
+                textureImage = makeTextureImage(*device_, std::move(image));
             }
 
-            if (!hasTangents) {
-                // Generate tangents.
-                generateTangents(MeshData{.vertices = vertices, .indices = indices});
+            for (const auto textureIndex: missingTextures) {
+                const auto& textureKey = textureKeys[textureIndex];
+                loadedTextures.emplace_back(
+                    textureIndex, textureKey,
+                    std::make_shared<Texture>(textureImage, device_->samplerCache().get(textureKey.sampler))
+                );
+                if (streaming.has_value()) {
+                    streamedTextures.push_back({
+                        .textureIndex = textureIndex,
+                        .key = textureKey,
+                        .image = textureImage,
+                        .source = streaming->first,
+                        .firstMip = streaming->second,
+                    });
+                }
+            }
+            if (batcher.pendingBytes() >= commitBytes) {
+                commitTextures();
             }
-
-            auto newMesh = std::make_shared<Mesh>(mesh.name.c_str(), device, vertices, indices, std::move(primitives));
-            meshes.push_back(newMesh);
-            meshes_[mesh.name.c_str()] = newMesh;
         }
+        commitTextures();
 
-        std::vector<std::shared_ptr<Node>> nodes;
+        return true;
+    }
 
-        for (fastgltf::Node& node: asset.nodes) {
-            std::shared_ptr<Node> newNode;
+    void GLTFAsset::post(uint64_t timelineValue, CommitFunction apply) {
+        std::lock_guard lock(commitMutex_);
+        commits_.push_back({.timelineValue = timelineValue, .apply = std::move(apply)});
+    }
 
-            if (node.meshIndex.has_value()) {
-                newNode = std::make_shared<MeshNode>(meshes[*node.meshIndex]);
-            } else {
-                newNode = std::make_shared<Node>();
-            }
+    void GLTFAsset::update(const vk::raii::CommandBuffer& commandBuffer) {
+        std::vector<Commit> ready;
+        {
+            // Commits are posted in timeline order, so stop at the first one
+            // whose uploads are still in flight.
+            const auto completedValue = device_->getUploadTimeline().getCounterValue();
 
-            nodes.push_back(newNode);
-            nodes_[node.name.c_str()] = newNode;
-
-            std::visit(
-                fastgltf::visitor{
-                    [&](fastgltf::math::fmat4x4 matrix) {
-                        std::memcpy(&newNode->localTransform, matrix.data(), sizeof(matrix));
-                    },
-                    [&](fastgltf::TRS transform) {
-                        glm::vec3 translation{
-                            transform.translation[0], transform.translation[1], transform.translation[2]
-                        };
-                        glm::quat rotation{
-                            transform.rotation[3], transform.rotation[0], transform.rotation[1], transform.rotation[2]
-                        };
-                        glm::vec3 scale{transform.scale[0], transform.scale[1], transform.scale[2]};
-
-                        glm::mat4 translationMatrix = glm::translate(glm::mat4(1.0f), translation);
-                        glm::mat4 rotationMatrix = glm::toMat4(rotation);
-                        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), scale);
-
-                        newNode->localTransform = translationMatrix * rotationMatrix * scaleMatrix;
-                    }
-                },
-                node.transform
-            );
+            std::lock_guard lock(commitMutex_);
+            const auto last = std::ranges::find_if(commits_, [completedValue](const Commit& commit) {
+                return commit.timelineValue > completedValue;
+            });
+            ready.assign(std::make_move_iterator(commits_.begin()), std::make_move_iterator(last));
+            commits_.erase(commits_.begin(), last);
         }
 
-        for (const auto& [assetNode, sceneNode]: std::views::zip(asset.nodes, nodes)) {
-            for (auto& childIndex: assetNode.children) {
-                auto& childNode = nodes[childIndex];
-                sceneNode->children.push_back(childNode);
-                childNode->parent = sceneNode;
-            }
+        for (auto& commit: ready) {
+            commit.apply(commandBuffer);
         }
+    }
 
-        for (auto& node: nodes) {
-            if (node->parent.lock() == nullptr) {
-                topNodes_.push_back(node);
-                node->refreshTransform(glm::mat4{1.0f});
-            }
+    void GLTFAsset::updateMaterials(const vk::raii::CommandBuffer& commandBuffer) {
+        const auto resolve = [this](const std::optional<size_t>& textureIndex) -> uint32_t {
+            return textureIndex.has_value() ? resourceIndex(textureHandles_[*textureIndex]) : 0;
+        };
+
+        for (const auto& [material, textures]: std::views::zip(materials_, materialTextures_)) {
+            material->normalTex = resolve(textures.normal);
+            material->albedoTex = resolve(textures.albedo);
+            material->metallicRoughnessTex = resolve(textures.metallicRoughness);
         }
+
+        materialManager_->updateResources(materialHandles_, commandBuffer);
     }
 
     void GLTFAsset::draw(const glm::mat4& topMatrix, DrawContext& context) {
+        context.firstMaterial = materialHandles_.empty() ? 0 : resourceIndex(materialHandles_.front());
         for (const auto& node: topNodes_) {
             node->draw(topMatrix, context);
         }
@@ -1,35 +1,149 @@
 #pragma once
 
+#include "renderer/gltf/import.h"
 #include "renderer/render_object.h"
+#include "renderer/resources/resource_manager.h"
+#include "renderer/resources/texture_manager.h"
 #include "renderer/vulkan_usage.h"
 #include "pch.h"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
 
 namespace yuubi {
 
     class Image;
     class Device;
+    class GeometryPool;
     class Node;
     class Mesh;
     class TextureManager;
     class MaterialManager;
-    class GLTFAsset final : NonCopyable, public Renderable {
+    class UploadBatcher;
+    struct MaterialData;
+
+    // A glTF scene loaded on a background thread. Parsing, image decoding and
+    // uploads happen on the loader thread while the render loop keeps
+    // presenting. Finished work is handed back to the render thread, which
+    // applies it in update() once the uploads it depends on have completed.
+    //
+    // Packages cooked by yuubi-cook (see CookedAsset) are loaded the same way,
+    // minus the parsing, decoding and tangent generation. Plain glTF files
+    // get their meshes from the mesh cache after the first load.
+    //
+    // The asset can be drawn right away. Meshes draw nothing until their
+    // geometry is resident, and materials sample the error checkerboard
+    // texture until their textures are.
+    class GLTFAsset final : NonCopyableOrMovable, public Renderable {
     public:
-        GLTFAsset() = default;
-        GLTFAsset(
-            Device& device, TextureManager& textureManager, MaterialManager& materialManager,
-            const std::filesystem::path& filePath
+        [[nodiscard]] static std::unique_ptr<GLTFAsset> loadAsync(
+            Device& device, GeometryPool& geometryPool, TextureManager& textureManager,
+            MaterialManager& materialManager, const std::filesystem::path& filePath
         );
 
-        // TODO: add move constructor/assignment operator
+        // Releases the cached textures the asset holds references on and
+        // removes its materials. Must be called on the render thread.
+        ~GLTFAsset() override;
+
+        // Applies finished loading work. Must be called on the render thread
+        // with commandBuffer recording the next frame, before any pass.
+        void update(const vk::raii::CommandBuffer& commandBuffer);
+        [[nodiscard]] bool isLoaded() const { return loaded_; }
+        // False once the loader thread has finished, whether or not loading
+        // succeeded.
+        [[nodiscard]] bool isLoading() const { return loading_; }
 
         void draw(const glm::mat4& topMatrix, DrawContext& context) override;
 
     private:
-        // GLTF resources.
+        using CommitFunction = std::move_only_function<void(const vk::raii::CommandBuffer&)>;
+
+        // Image to upload, and the file it can be streamed from if its full
+        // mip chain is on disk.
+        struct SourceImage {
+            ImageData data;
+            std::filesystem::path streamingPath;
+        };
+
+        // Loader work applied on the render thread once the upload timeline
+        // reaches timelineValue.
+        struct Commit {
+            uint64_t timelineValue;
+            CommitFunction apply;
+        };
+
+        GLTFAsset(
+            Device& device, GeometryPool& geometryPool, TextureManager& textureManager, MaterialManager& materialManager
+        );
+
+        void load(const std::stop_token& stopToken, const std::filesystem::path& filePath);
+        bool loadGltf(const std::stop_token& stopToken, UploadBatcher& batcher, const std::filesystem::path& filePath);
+        bool loadCooked(
+            const std::stop_token& stopToken, UploadBatcher& batcher, const std::filesystem::path& filePath
+        );
+
+        // Builds the node hierarchy and hands it to the render thread along
+        // with the materials. Returns the meshes the nodes draw, which stay
+        // empty until uploadMeshes() fills them in.
+        std::vector<std::shared_ptr<Mesh>> publishScene(
+            std::span<const ImportedMaterial> importedMaterials, std::span<const ImportedNode> importedNodes,
+            std::span<const std::string> meshNames, size_t numTextures
+        );
+        // Uploads the mesh returned by getMesh for each of meshes. The view
+        // only has to stay valid until the next call. Returns false if loading
+        // was cancelled.
+        bool uploadMeshes(
+            const std::stop_token& stopToken, UploadBatcher& batcher, std::span<const std::shared_ptr<Mesh>> meshes,
+            const std::function<MeshView(size_t)>& getMesh
+        );
+        // Creates one texture per entry of textureKeys, sampling the image
+        // at the same index of textureImages. Textures already in the
+        // TextureManager's cache are reused, and each of numImages images is
+        // uploaded at most once, as returned by getImage, which may block until
+        // the image is decoded. Images are released as soon as their pixels are
+        // in staging memory. Streamable images are uploaded with only their mip
+        // tail and handed to the TextureManager to stream. Returns false if
+        // loading was cancelled.
+        bool uploadTextures(
+            const std::stop_token& stopToken, UploadBatcher& batcher, std::span<const TextureKey> textureKeys,
+            std::span<const size_t> textureImages, size_t numImages,
+            const std::function<SourceImage(size_t)>& getImage, const std::function<void(size_t)>& releaseImage
+        );
+        void post(uint64_t timelineValue, CommitFunction apply);
+        // Points materials at every texture that is resident so far.
+        void updateMaterials(const vk::raii::CommandBuffer& commandBuffer);
+
+        Device* device_;
+        GeometryPool* geometryPool_;
+        TextureManager* textureManager_;
+        MaterialManager* materialManager_;
+
+        // GLTF resources. Only accessed on the render thread.
         std::unordered_map<std::string, std::shared_ptr<Mesh>> meshes_;
         std::unordered_map<std::string, std::shared_ptr<Node>> nodes_;
 
         std::vector<std::shared_ptr<Node>> topNodes_;
+
+        std::vector<std::shared_ptr<MaterialData>> materials_;
+        std::vector<MaterialTextures> materialTextures_;
+        // Consecutive, in glTF material order.
+        std::vector<ResourceHandle> materialHandles_;
+        // Texture handle of each glTF texture, or the error texture while it
+        // is still loading.
+        std::vector<ResourceHandle> textureHandles_;
+        bool loaded_ = false;
+        std::atomic<bool> loading_ = true;
+
+        std::mutex commitMutex_;
+        std::vector<Commit> commits_;
+        // Cached textures this asset holds a reference on. Guarded by
+        // commitMutex_.
+        std::vector<ResourceHandle> acquiredTextures_;
+
+        // Declared last so the loader is joined before anything it uses is
+        // destroyed.
+        std::jthread loader_;
     };
 
 }
@@ -0,0 +1,229 @@
+#include "renderer/gltf/cooked_asset.h"
+
+#include <fstream>
+
+namespace {
+
+    constexpr uint32_t cookedAssetMagic = 0x41434259; // "YBCA"
+
+    constexpr int64_t noIndex = -1;
+
+    // Alignment of every array in the package, relative to its start.
+    constexpr size_t arrayAlignment = 16;
+
+    class Writer {
+    public:
+        explicit Writer(const std::filesystem::path& path) : file_(path, std::ios::binary) {}
+
+        [[nodiscard]] bool ok() const { return file_.good(); }
+
+        template<typename T>
+            requires std::is_trivially_copyable_v<T>
+        void write(const T& value) {
+            writeBytes({reinterpret_cast<const char*>(&value), sizeof(T)});
+        }
+
+        template<typename T>
+            requires std::is_trivially_copyable_v<T> && (alignof(T) <= arrayAlignment)
+        void writeSpan(std::span<const T> values) {
+            write<uint64_t>(values.size());
+            constexpr std::array<char, arrayAlignment> padding{};
+            writeBytes(std::span(padding).first((arrayAlignment - offset_ % arrayAlignment) % arrayAlignment));
+            writeBytes({reinterpret_cast<const char*>(values.data()), values.size_bytes()});
+        }
+
+        void writeString(std::string_view string) { writeSpan(std::span{string.data(), string.size()}); }
+
+        void writeIndex(const std::optional<size_t>& index) {
+            write<int64_t>(index.has_value() ? static_cast<int64_t>(*index) : noIndex);
+        }
+
+    private:
+        void writeBytes(std::span<const char> bytes) {
+            file_.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            offset_ += bytes.size();
+        }
+
+        std::ofstream file_;
+        size_t offset_ = 0;
+    };
+
+    // Reads from a whole package in memory, which must be aligned to
+    // arrayAlignment. Every read is bounds checked, and the first failure is
+    // sticky.
+    class Reader {
+    public:
+        explicit Reader(std::span<const char> bytes) : bytes_(bytes) {}
+
+        [[nodiscard]] bool ok() const { return ok_; }
+
+        template<typename T>
+            requires std::is_trivially_copyable_v<T>
+        T read() {
+            T value{};
+            if (const auto bytes = take(sizeof(T)); !bytes.empty()) {
+                std::memcpy(&value, bytes.data(), sizeof(T));
+            }
+            return value;
+        }
+
+        // Returns a view of an array in place, valid for as long as the
+        // package stays in memory.
+        template<typename T>
+            requires std::is_trivially_copyable_v<T> && (alignof(T) <= arrayAlignment)
+        std::span<const T> readSpan() {
+            const auto count = read<uint64_t>();
+            take((arrayAlignment - offset_ % arrayAlignment) % arrayAlignment);
+            if (!ok_ || count > (bytes_.size() - offset_) / sizeof(T)) {
+                ok_ = false;
+                return {};
+            }
+
+            const auto bytes = take(count * sizeof(T));
+            return {reinterpret_cast<const T*>(bytes.data()), count};
+        }
+
+        template<typename T>
+        std::vector<T> readVector() {
+            const auto values = readSpan<T>();
+            return {values.begin(), values.end()};
+        }
+
+        std::string readString() {
+            const auto chars = readSpan<char>();
+            return {chars.begin(), chars.end()};
+        }
+
+        std::optional<size_t> readIndex() {
+            const auto index = read<int64_t>();
+            return index == noIndex ? std::nullopt : std::optional<size_t>(index);
+        }
+
+    private:
+        std::span<const char> take(size_t size) {
+            if (!ok_ || size > bytes_.size() - offset_) {
+                ok_ = false;
+                return {};
+            }
+
+            const auto bytes = bytes_.subspan(offset_, size);
+            offset_ += size;
+            return bytes;
+        }
+
+        std::span<const char> bytes_;
+        size_t offset_ = 0;
+        bool ok_ = true;
+    };
+
+}
+
+namespace yuubi {
+
+    bool writeCookedAsset(const std::filesystem::path& path, const CookedAsset& asset) {
+        Writer writer(path);
+        writer.write(cookedAssetMagic);
+        writer.write(cookedAssetVersion);
+
+        writer.write<uint64_t>(asset.materials.size());
+        for (const auto& material: asset.materials) {
+            writer.write(material.data);
+            writer.writeIndex(material.textures.normal);
+            writer.writeIndex(material.textures.albedo);
+            writer.writeIndex(material.textures.metallicRoughness);
+            writer.write<uint8_t>(material.transparent);
+        }
+
+        writer.write<uint64_t>(asset.textures.size());
+        for (const auto& texture: asset.textures) {
+            writer.writeString(texture.image.generic_string());
+            writer.write(texture.sampler);
+        }
+
+        writer.write<uint64_t>(asset.meshes.size());
+        for (const auto& mesh: asset.meshes) {
+            writer.writeString(mesh.name);
+            writer.write(mesh.format);
+            writer.writeSpan(mesh.vertices);
+            writer.writeSpan(mesh.indices);
+            writer.writeSpan(mesh.surfaces);
+        }
+
+        writer.write<uint64_t>(asset.nodes.size());
+        for (const auto& node: asset.nodes) {
+            writer.writeString(node.name);
+            writer.writeIndex(node.mesh);
+            writer.write(node.localTransform);
+            writer.writeSpan(std::span<const size_t>(node.children));
+        }
+
+        if (!writer.ok()) {
+            UB_ERROR("Unable to write cooked asset: {}", path.string());
+            return false;
+        }
+        return true;
+    }
+
+    std::optional<CookedAsset> readCookedAsset(const std::filesystem::path& path) {
+        CookedAsset asset{.mapping = MappedFile(path)};
+        if (!asset.mapping.isOpen()) {
+            UB_ERROR("Unable to open cooked asset: {}", path.string());
+            return std::nullopt;
+        }
+
+        Reader reader(asset.mapping.bytes());
+
+        if (reader.read<uint32_t>() != cookedAssetMagic) {
+            UB_ERROR("Not a cooked asset: {}", path.string());
+            return std::nullopt;
+        }
+        if (const auto version = reader.read<uint32_t>(); version != cookedAssetVersion) {
+            UB_ERROR("Cooked asset {} has version {}, expected {}", path.string(), version, cookedAssetVersion);
+            return std::nullopt;
+        }
+
+        const auto numMaterials = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < numMaterials && reader.ok(); i++) {
+            auto& material = asset.materials.emplace_back();
+            material.data = reader.read<MaterialData>();
+            material.textures.normal = reader.readIndex();
+            material.textures.albedo = reader.readIndex();
+            material.textures.metallicRoughness = reader.readIndex();
+            material.transparent = reader.read<uint8_t>() != 0;
+        }
+
+        const auto numTextures = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < numTextures && reader.ok(); i++) {
+            auto& texture = asset.textures.emplace_back();
+            texture.image = reader.readString();
+            texture.sampler = reader.read<SamplerInfo>();
+        }
+
+        const auto numMeshes = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < numMeshes && reader.ok(); i++) {
+            auto& mesh = asset.meshes.emplace_back();
+            const auto name = reader.readSpan<char>();
+            mesh.name = {name.data(), name.size()};
+            mesh.format = reader.read<GeometryFormat>();
+            mesh.vertices = reader.readSpan<std::byte>();
+            mesh.indices = reader.readSpan<std::byte>();
+            mesh.surfaces = reader.readSpan<GeoSurface>();
+        }
+
+        const auto numNodes = reader.read<uint64_t>();
+        for (uint64_t i = 0; i < numNodes && reader.ok(); i++) {
+            auto& node = asset.nodes.emplace_back();
+            node.name = reader.readString();
+            node.mesh = reader.readIndex();
+            node.localTransform = reader.read<glm::mat4>();
+            node.children = reader.readVector<size_t>();
+        }
+
+        if (!reader.ok()) {
+            UB_ERROR("Cooked asset is truncated: {}", path.string());
+            return std::nullopt;
+        }
+        return asset;
+    }
+
+}
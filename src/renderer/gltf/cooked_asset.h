@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/io/mapped_file.h"
+#include "renderer/gltf/import.h"
+#include "pch.h"
+
+namespace yuubi {
+
+    // A glTF scene processed offline by yuubi-cook. Meshes are stored as final
+    // vertex and index streams with tangents, encoded in the GeometryFormat
+    // they were imported with, and every image as a mipped, block-compressed
+    // KTX2 file next to the package, so loading one needs neither image
+    // decoding nor tangent generation.
+    //
+    // Packages are read by mapping them into memory. Vertex, index and surface
+    // streams are aligned in the file so meshes can point straight into the
+    // mapping and be copied from there into staging memory.
+    struct CookedAsset {
+        struct Texture {
+            // Relative to the package.
+            std::filesystem::path image;
+            SamplerInfo sampler;
+        };
+
+        std::vector<ImportedMaterial> materials;
+        std::vector<Texture> textures;
+        std::vector<MeshView> meshes;
+        std::vector<ImportedNode> nodes;
+        // Backs meshes when the asset was read from disk.
+        MappedFile mapping;
+    };
+
+    constexpr std::string_view cookedAssetExtension = ".ybasset";
+    // Bump when the layout of the package or of anything it stores changes.
+    constexpr uint32_t cookedAssetVersion = 3;
+
+    bool writeCookedAsset(const std::filesystem::path& path, const CookedAsset& asset);
+    [[nodiscard]] std::optional<CookedAsset> readCookedAsset(const std::filesystem::path& path);
+
+}
@@ -0,0 +1,167 @@
+#include "renderer/gltf/image_decoder.h"
+
+#include <chrono>
+#include <spng.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#include <turbojpeg.h>
+
+namespace {
+
+    using yuubi::DecodedPixels;
+
+    DecodedPixels::Buffer allocatePixels(size_t size) {
+        return {static_cast<unsigned char*>(std::malloc(size)), [](void* pixels) { std::free(pixels); }};
+    }
+
+    class SpngDecoder final : public yuubi::ImageDecoder {
+    public:
+        [[nodiscard]] std::string_view name() const override { return "spng"; }
+
+        [[nodiscard]] bool canDecode(std::span<const unsigned char> bytes) const override {
+            constexpr std::array<unsigned char, 8> signature{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+            return bytes.size() >= signature.size() && std::ranges::equal(bytes.first(signature.size()), signature);
+        }
+
+        [[nodiscard]] std::optional<DecodedPixels> decode(std::span<const unsigned char> bytes) const override {
+            // Checksums are skipped. Corrupt files fail to inflate anyway.
+            const std::unique_ptr<spng_ctx, decltype(&spng_ctx_free)> context{
+                spng_ctx_new(SPNG_CTX_IGNORE_ADLER32), spng_ctx_free
+            };
+            spng_ihdr header{};
+            spng_trns transparency{};
+            if (context == nullptr || spng_set_crc_action(context.get(), SPNG_CRC_USE, SPNG_CRC_USE) != 0 ||
+                spng_set_png_buffer(context.get(), bytes.data(), bytes.size()) != 0 ||
+                spng_get_ihdr(context.get(), &header) != 0) {
+                return std::nullopt;
+            }
+
+            // Gray and RGB images stay that way and are expanded to RGBA on
+            // upload. Anything with transparency, a palette or 16-bit alpha
+            // is decoded to RGBA right away.
+            const bool hasTransparency = spng_get_trns(context.get(), &transparency) == 0;
+            auto format = SPNG_FMT_RGBA8;
+            uint32_t numChannels = 4;
+            if (!hasTransparency && header.color_type == SPNG_COLOR_TYPE_GRAYSCALE && header.bit_depth <= 8) {
+                format = SPNG_FMT_G8;
+                numChannels = 1;
+            } else if (!hasTransparency && header.color_type == SPNG_COLOR_TYPE_TRUECOLOR) {
+                format = SPNG_FMT_RGB8;
+                numChannels = 3;
+            }
+
+            size_t size = 0;
+            if (spng_decoded_image_size(context.get(), format, &size) != 0) {
+                return std::nullopt;
+            }
+            DecodedPixels result{
+                .pixels = allocatePixels(size),
+                .width = header.width,
+                .height = header.height,
+                .numChannels = numChannels,
+            };
+            if (result.pixels == nullptr ||
+                spng_decode_image(context.get(), result.pixels.get(), size, format, SPNG_DECODE_TRNS) != 0) {
+                return std::nullopt;
+            }
+            return result;
+        }
+    };
+
+    class TurboJpegDecoder final : public yuubi::ImageDecoder {
+    public:
+        [[nodiscard]] std::string_view name() const override { return "libjpeg-turbo"; }
+
+        [[nodiscard]] bool canDecode(std::span<const unsigned char> bytes) const override {
+            return bytes.size() >= 3 && bytes[0] == 0xff && bytes[1] == 0xd8 && bytes[2] == 0xff;
+        }
+
+        [[nodiscard]] std::optional<DecodedPixels> decode(std::span<const unsigned char> bytes) const override {
+            const std::unique_ptr<void, decltype(&tj3Destroy)> handle{tj3Init(TJINIT_DECOMPRESS), tj3Destroy};
+            if (handle == nullptr || tj3DecompressHeader(handle.get(), bytes.data(), bytes.size()) != 0) {
+                return std::nullopt;
+            }
+
+            const bool gray = tj3Get(handle.get(), TJPARAM_COLORSPACE) == TJCS_GRAY;
+            const auto pixelFormat = gray ? TJPF_GRAY : TJPF_RGB;
+            DecodedPixels result{
+                .width = static_cast<uint32_t>(tj3Get(handle.get(), TJPARAM_JPEGWIDTH)),
+                .height = static_cast<uint32_t>(tj3Get(handle.get(), TJPARAM_JPEGHEIGHT)),
+                .numChannels = static_cast<uint32_t>(tjPixelSize[pixelFormat]),
+            };
+            result.pixels =
+                allocatePixels(static_cast<size_t>(result.width) * result.height * result.numChannels);
+            if (result.pixels == nullptr ||
+                tj3Decompress8(handle.get(), bytes.data(), bytes.size(), result.pixels.get(), 0, pixelFormat) != 0) {
+                return std::nullopt;
+            }
+            return result;
+        }
+    };
+
+    class StbDecoder final : public yuubi::ImageDecoder {
+    public:
+        [[nodiscard]] std::string_view name() const override { return "stb_image"; }
+
+        [[nodiscard]] bool canDecode(std::span<const unsigned char>) const override { return true; }
+
+        [[nodiscard]] std::optional<DecodedPixels> decode(std::span<const unsigned char> bytes) const override {
+            int width = 0;
+            int height = 0;
+            int numChannels = 0;
+            auto* pixels = stbi_load_from_memory(
+                bytes.data(), static_cast<int>(bytes.size()), &width, &height, &numChannels, 0
+            );
+            if (pixels == nullptr) {
+                return std::nullopt;
+            }
+            return DecodedPixels{
+                .pixels = {pixels, stbi_image_free},
+                .width = static_cast<uint32_t>(width),
+                .height = static_cast<uint32_t>(height),
+                .numChannels = static_cast<uint32_t>(numChannels),
+            };
+        }
+    };
+
+    const std::vector<std::unique_ptr<yuubi::ImageDecoder>>& decoders() {
+        static const auto decoders = [] {
+            std::vector<std::unique_ptr<yuubi::ImageDecoder>> result;
+            const char* choice = std::getenv("YUUBI_IMAGE_DECODER");
+            if (choice == nullptr || std::string_view(choice) != "stb") {
+                result.push_back(std::make_unique<SpngDecoder>());
+                result.push_back(std::make_unique<TurboJpegDecoder>());
+            }
+            result.push_back(std::make_unique<StbDecoder>());
+            UB_INFO("Image decoders: {}", result.size() > 1 ? "spng, libjpeg-turbo, stb_image" : "stb_image");
+            return result;
+        }();
+        return decoders;
+    }
+
+}
+
+namespace yuubi {
+
+    std::optional<DecodedPixels> decodeImage(std::span<const unsigned char> bytes) {
+        for (const auto& decoder: decoders()) {
+            if (!decoder->canDecode(bytes)) {
+                continue;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            auto result = decoder->decode(bytes);
+            if (result.has_value()) {
+                const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+                UB_INFO(
+                    "Decoded {}x{} image with {} in {:.2f} ms", result->width, result->height, decoder->name(),
+                    duration.count()
+                );
+                return result;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+}
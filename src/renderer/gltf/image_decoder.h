@@ -0,0 +1,38 @@
+#pragma once
+
+#include "pch.h"
+
+namespace yuubi {
+
+    // 8-bit pixels with the channels the image was stored with, tightly
+    // packed.
+    struct DecodedPixels {
+        using Buffer = std::unique_ptr<unsigned char[], void (*)(void*)>;
+
+        Buffer pixels{nullptr, [](void* pixels) { std::free(pixels); }};
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t numChannels = 0;
+    };
+
+    // Decodes one family of compressed image formats. Decoders are shared by
+    // every loader thread and job, so decode() must be thread-safe.
+    class ImageDecoder {
+    public:
+        virtual ~ImageDecoder() = default;
+
+        [[nodiscard]] virtual std::string_view name() const = 0;
+        // Sniffs the magic bytes of an encoded image.
+        [[nodiscard]] virtual bool canDecode(std::span<const unsigned char> bytes) const = 0;
+        // Returns nothing if the image is malformed or unsupported.
+        [[nodiscard]] virtual std::optional<DecodedPixels> decode(std::span<const unsigned char> bytes) const = 0;
+    };
+
+    // Decodes bytes with the first decoder that recognizes them: libspng for
+    // PNG and libjpeg-turbo for JPEG, both SIMD accelerated, with stb_image
+    // for anything else and anything they fail on. Setting the environment
+    // variable YUUBI_IMAGE_DECODER to "stb" decodes everything with stb_image
+    // instead. Decode times are logged per image.
+    [[nodiscard]] std::optional<DecodedPixels> decodeImage(std::span<const unsigned char> bytes);
+
+}
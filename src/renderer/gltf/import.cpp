@@ -0,0 +1,396 @@
+#include "renderer/gltf/import.h"
+
+#include "core/job_system.h"
+#include "renderer/gltf/accessor.h"
+#include "renderer/gltf/mikktspace.h"
+#include <fastgltf/core.hpp>
+#include <fastgltf/tools.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <meshoptimizer.h>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/quaternion.hpp>
+
+namespace {
+
+    // Maps a unit vector onto the octahedron unfolded into [-1, 1]^2.
+    // Degenerate vectors, which some meshes have, encode as +z.
+    glm::vec2 octahedralEncode(glm::vec3 v) {
+        const float norm = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        if (!(norm > std::numeric_limits<float>::min())) {
+            return glm::vec2{0.0f};
+        }
+        v /= norm;
+        glm::vec2 encoded{v.x, v.y};
+        if (v.z < 0.0f) {
+            const glm::vec2 sign{encoded.x >= 0.0f ? 1.0f : -1.0f, encoded.y >= 0.0f ? 1.0f : -1.0f};
+            encoded = (1.0f - glm::abs(glm::vec2{encoded.y, encoded.x})) * sign;
+        }
+        return encoded;
+    }
+
+    yuubi::CompactVertex compactVertex(const yuubi::Vertex& vertex, const yuubi::GeometryFormat& format) {
+        const auto extent = format.positionExtent;
+        const auto position = glm::clamp(
+            glm::vec3{
+                extent.x > 0.0f ? (vertex.position.x - format.positionMin.x) / extent.x : 0.0f,
+                extent.y > 0.0f ? (vertex.position.y - format.positionMin.y) / extent.y : 0.0f,
+                extent.z > 0.0f ? (vertex.position.z - format.positionMin.z) / extent.z : 0.0f,
+            },
+            0.0f, 1.0f
+        );
+        const float tangentSign = vertex.tangent.w < 0.0f ? -1.0f : 1.0f;
+
+        return {
+            .positionXY = glm::packUnorm2x16({position.x, position.y}),
+            .positionZTangentSign = (glm::packUnorm2x16({position.z, 0.0f}) & 0xffff) |
+                                    (glm::packSnorm2x16({0.0f, tangentSign}) & 0xffff0000),
+            .uv = glm::packHalf2x16({vertex.uv_x, vertex.uv_y}),
+            .normal = glm::packSnorm2x16(octahedralEncode(vertex.normal)),
+            .tangent = glm::packSnorm2x16(octahedralEncode(glm::vec3(vertex.tangent))),
+        };
+    }
+
+    template<typename T>
+    void appendBytes(std::vector<std::byte>& bytes, const T& value) {
+        const auto* data = reinterpret_cast<const std::byte*>(&value);
+        bytes.insert(bytes.end(), data, data + sizeof(T));
+    }
+
+    std::vector<std::byte> encodeVertices(
+        std::span<const yuubi::Vertex> vertices, const yuubi::GeometryFormat& format
+    ) {
+        std::vector<std::byte> bytes;
+        bytes.reserve(vertices.size() * yuubi::vertexStride(format.vertexFormat));
+
+        for (const auto& vertex: vertices) {
+            switch (format.vertexFormat) {
+                case yuubi::VertexFormat::Full:
+                    appendBytes(bytes, vertex);
+                    break;
+                case yuubi::VertexFormat::Compact:
+                    appendBytes(bytes, compactVertex(vertex, format));
+                    break;
+                case yuubi::VertexFormat::CompactColor:
+                    appendBytes(
+                        bytes,
+                        yuubi::CompactColorVertex{
+                            .vertex = compactVertex(vertex, format),
+                            .color = glm::packUnorm4x8(glm::clamp(vertex.color, 0.0f, 1.0f)),
+                        }
+                    );
+                    break;
+            }
+        }
+
+        return bytes;
+    }
+
+    template<typename T>
+    std::vector<std::byte> encodeIndices(std::span<const uint32_t> indices) {
+        std::vector<std::byte> bytes;
+        bytes.reserve(indices.size() * sizeof(T));
+        for (const auto index: indices) {
+            appendBytes(bytes, static_cast<T>(index));
+        }
+        return bytes;
+    }
+
+    struct ImportedPrimitive {
+        std::vector<yuubi::Vertex> vertices;
+        std::vector<uint32_t> indices;
+        bool hasTangents = false;
+        bool hasColors = false;
+        // Accessor bytes the primitive was converted from.
+        size_t sourceBytes = 0;
+    };
+
+    ImportedPrimitive importPrimitive(const fastgltf::Asset& asset, const fastgltf::Primitive& primitive) {
+        using yuubi::Vertex;
+
+        ImportedPrimitive result;
+        auto& vertices = result.vertices;
+
+        const auto convert = [&](const fastgltf::Accessor& accessor, const yuubi::AttributeTarget& target) {
+            const auto bytesRead = yuubi::convertAccessor(asset, accessor, target);
+            if (!bytesRead.has_value()) {
+                UB_ERROR("Accessor {} of a primitive isn't loaded", accessor.name.c_str());
+                return false;
+            }
+            result.sourceBytes += *bytesRead;
+            return true;
+        };
+        const auto findAccessor = [&](std::string_view attribute) -> const fastgltf::Accessor* {
+            const auto* iter = primitive.findAttribute(attribute);
+            return iter != primitive.attributes.end() ? &asset.accessors[iter->accessorIndex] : nullptr;
+        };
+
+        // Load indices.
+        {
+            const fastgltf::Accessor& indexAccessor = asset.accessors[primitive.indicesAccessor.value()];
+            result.indices.resize(indexAccessor.count);
+            const auto bytesRead = yuubi::convertIndices(asset, indexAccessor, result.indices);
+            if (!bytesRead.has_value()) {
+                UB_ERROR("Index accessor {} of a primitive isn't loaded", indexAccessor.name.c_str());
+                result.indices.clear();
+            }
+            result.sourceBytes += bytesRead.value_or(0);
+        }
+
+        // Each attribute is converted straight into its place in the
+        // interleaved vertices.
+        const auto* positions = findAccessor("POSITION");
+        vertices.assign(
+            positions->count,
+            Vertex{
+                .position = glm::vec3{0.0f},
+                .uv_x = 0,
+                .normal = {1.0f, 0.0f, 0.0f},
+                .uv_y = 0,
+                .color = glm::vec4{1.0f},
+                .tangent = glm::vec4{0.0f},
+            }
+        );
+        const std::span<Vertex> target = vertices;
+
+        convert(*positions, yuubi::attributeTarget(target, &Vertex::position));
+        if (const auto* accessor = findAccessor("NORMAL")) {
+            convert(*accessor, yuubi::attributeTarget(target, &Vertex::normal));
+        }
+        // TODO: support all texcoords
+        if (const auto* accessor = findAccessor("TEXCOORD_0")) {
+            convert(
+                *accessor,
+                {
+                    .base = reinterpret_cast<std::byte*>(vertices.data()),
+                    .stride = sizeof(Vertex),
+                    .offsets = {offsetof(Vertex, uv_x), offsetof(Vertex, uv_y)},
+                    .components = 2,
+                }
+            );
+        }
+        if (const auto* accessor = findAccessor("COLOR_0")) {
+            // RGB colors keep the default alpha of 1.
+            result.hasColors = convert(*accessor, yuubi::attributeTarget(target, &Vertex::color));
+        }
+        if (const auto* accessor = findAccessor("TANGENT")) {
+            result.hasTangents = convert(*accessor, yuubi::attributeTarget(target, &Vertex::tangent));
+        }
+
+        return result;
+    }
+
+    // Welds identical vertices, then orders triangles for the post-transform
+    // cache and for less overdraw, and finally orders vertices by first use
+    // so fetches stay local.
+    void optimizeGeometry(std::vector<yuubi::Vertex>& vertices, std::vector<uint32_t>& indices) {
+        if (vertices.empty() || indices.size() % 3 != 0) {
+            return;
+        }
+
+        std::vector<uint32_t> remap(vertices.size());
+        const auto vertexCount = meshopt_generateVertexRemap(
+            remap.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(yuubi::Vertex)
+        );
+        meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+        std::vector<yuubi::Vertex> welded(vertexCount);
+        meshopt_remapVertexBuffer(welded.data(), vertices.data(), vertices.size(), sizeof(yuubi::Vertex), remap.data());
+        vertices = std::move(welded);
+
+        meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), vertices.size());
+        // Allow the cache hit rate to get up to 5% worse in exchange for less
+        // overdraw.
+        constexpr float overdrawThreshold = 1.05f;
+        meshopt_optimizeOverdraw(
+            indices.data(), indices.data(), indices.size(), &vertices[0].position.x, vertices.size(),
+            sizeof(yuubi::Vertex), overdrawThreshold
+        );
+        meshopt_optimizeVertexFetch(
+            vertices.data(), indices.data(), indices.size(), vertices.data(), vertices.size(), sizeof(yuubi::Vertex)
+        );
+    }
+
+    std::pair<vk::Filter, vk::SamplerMipmapMode> getSamplerFilterInfo(fastgltf::Filter filter) {
+        switch (filter) {
+            case fastgltf::Filter::Nearest:
+                return {vk::Filter::eNearest, vk::SamplerMipmapMode::eLinear};
+            case fastgltf::Filter::NearestMipMapNearest:
+                return {vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest};
+            case fastgltf::Filter::NearestMipMapLinear:
+                return {vk::Filter::eNearest, vk::SamplerMipmapMode::eLinear};
+
+            case fastgltf::Filter::Linear:
+                return {vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear};
+            case fastgltf::Filter::LinearMipMapNearest:
+                return {vk::Filter::eLinear, vk::SamplerMipmapMode::eNearest};
+            case fastgltf::Filter::LinearMipMapLinear:
+                return {vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear};
+
+            default:
+                return {vk::Filter::eNearest, vk::SamplerMipmapMode::eLinear};
+        }
+    }
+
+}
+
+namespace yuubi {
+
+    std::vector<ImportedMaterial> importMaterials(const fastgltf::Asset& asset) {
+        std::vector<ImportedMaterial> materials;
+        for (const fastgltf::Material& fastgltfMaterial: asset.materials) {
+            // TODO: get more texture data
+            auto getTextureIndex = [](const auto& textureInfo) -> std::optional<size_t> {
+                return textureInfo.transform([](const auto& texture) { return texture.textureIndex; });
+            };
+
+            auto normalScale =
+                fastgltfMaterial.normalTexture.transform([](const auto& texture) { return texture.scale; }
+                ).value_or(1);
+
+            // PERF: Ignore alphaCutoff in other modes.
+            auto alphaCutoff =
+                fastgltfMaterial.alphaMode == fastgltf::AlphaMode::Mask ? fastgltfMaterial.alphaCutoff : 1.0;
+
+            materials.push_back({
+                .data = MaterialData(
+                    0, normalScale,
+
+                    0, 0,
+                    glm::vec4{
+                        fastgltfMaterial.pbrData.baseColorFactor.x(), fastgltfMaterial.pbrData.baseColorFactor.y(),
+                        fastgltfMaterial.pbrData.baseColorFactor.z(), fastgltfMaterial.pbrData.baseColorFactor.w()
+                    },
+
+                    0, fastgltfMaterial.pbrData.metallicFactor, fastgltfMaterial.pbrData.roughnessFactor, alphaCutoff
+                ),
+                .textures{
+                    .normal = getTextureIndex(fastgltfMaterial.normalTexture),
+                    .albedo = getTextureIndex(fastgltfMaterial.pbrData.baseColorTexture),
+                    .metallicRoughness = getTextureIndex(fastgltfMaterial.pbrData.metallicRoughnessTexture),
+                },
+                .transparent = fastgltfMaterial.alphaMode == fastgltf::AlphaMode::Blend,
+            });
+        }
+
+        return materials;
+    }
+
+    std::vector<ImportedNode> importNodes(const fastgltf::Asset& asset) {
+        std::vector<ImportedNode> nodes;
+        for (const fastgltf::Node& node: asset.nodes) {
+            auto& newNode = nodes.emplace_back(ImportedNode{
+                .name = node.name.c_str(),
+                .mesh = node.meshIndex.has_value() ? std::optional<size_t>(*node.meshIndex) : std::nullopt,
+                .children = {node.children.begin(), node.children.end()},
+            });
+
+            std::visit(
+                fastgltf::visitor{
+                    [&](fastgltf::math::fmat4x4 matrix) {
+                        std::memcpy(&newNode.localTransform, matrix.data(), sizeof(matrix));
+                    },
+                    [&](fastgltf::TRS transform) {
+                        glm::vec3 translation{
+                            transform.translation[0], transform.translation[1], transform.translation[2]
+                        };
+                        glm::quat rotation{
+                            transform.rotation[3], transform.rotation[0], transform.rotation[1], transform.rotation[2]
+                        };
+                        glm::vec3 scale{transform.scale[0], transform.scale[1], transform.scale[2]};
+
+                        glm::mat4 translationMatrix = glm::translate(glm::mat4(1.0f), translation);
+                        glm::mat4 rotationMatrix = glm::toMat4(rotation);
+                        glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), scale);
+
+                        newNode.localTransform = translationMatrix * rotationMatrix * scaleMatrix;
+                    }
+                },
+                node.transform
+            );
+        }
+
+        return nodes;
+    }
+
+    ImportedMesh importMesh(
+        const fastgltf::Asset& asset, const fastgltf::Mesh& mesh, std::span<const ImportedMaterial> materials,
+        VertexFormat vertexFormat
+    ) {
+        ImportedMesh result{.name = mesh.name.c_str()};
+
+        // Primitives don't share vertices, so each one is converted and
+        // optimized on its own.
+        std::vector<ImportedPrimitive> primitives(mesh.primitives.size());
+        JobSystem::get().parallelFor(primitives.size(), [&](size_t i) {
+            auto& primitive = primitives[i];
+            primitive = importPrimitive(asset, mesh.primitives[i]);
+            if (!primitive.hasTangents) {
+                generateTangents(MeshData{.vertices = primitive.vertices, .indices = primitive.indices});
+            }
+            optimizeGeometry(primitive.vertices, primitive.indices);
+        });
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        bool hasColors = false;
+        for (const auto& [gltfPrimitive, primitive]: std::views::zip(mesh.primitives, primitives)) {
+            // Primitives without a material use the default one, which assets
+            // place after their own materials.
+            GeoSurface surface{
+                .startIndex = static_cast<uint32_t>(indices.size()),
+                .count = static_cast<uint32_t>(primitive.indices.size()),
+                .materialIndex = static_cast<uint32_t>(gltfPrimitive.materialIndex.value_or(materials.size())),
+            };
+            surface.passType = surface.materialIndex < materials.size() && materials[surface.materialIndex].transparent
+                                   ? MaterialPass::Transparent
+                                   : MaterialPass::Opaque;
+            result.surfaces.push_back(surface);
+
+            const auto firstIndex = indices.size();
+            indices.resize(firstIndex + primitive.indices.size());
+            rebaseIndices(
+                primitive.indices, static_cast<uint32_t>(vertices.size()), std::span{indices}.subspan(firstIndex)
+            );
+            vertices.insert(vertices.end(), primitive.vertices.begin(), primitive.vertices.end());
+            hasColors |= primitive.hasColors;
+            result.sourceBytes += primitive.sourceBytes;
+        }
+
+        auto& format = result.format;
+        format.vertexFormat = vertexFormat == VertexFormat::Compact && hasColors ? VertexFormat::CompactColor
+                                                                                 : vertexFormat;
+        if (format.vertexFormat != VertexFormat::Full && !vertices.empty()) {
+            const auto [min, max] = std::ranges::fold_left(
+                vertices, std::pair{vertices[0].position, vertices[0].position},
+                [](const auto& bounds, const Vertex& vertex) {
+                    return std::pair{glm::min(bounds.first, vertex.position), glm::max(bounds.second, vertex.position)};
+                }
+            );
+            format.positionMin = min;
+            format.positionExtent = max - min;
+        }
+        result.vertices = encodeVertices(vertices, format);
+
+        // Indices are relative to the mesh, so small meshes get away with
+        // half the index bandwidth.
+        if (vertices.size() <= std::numeric_limits<uint16_t>::max() + 1uz) {
+            format.indexType = vk::IndexType::eUint16;
+            result.indices = encodeIndices<uint16_t>(indices);
+        } else {
+            format.indexType = vk::IndexType::eUint32;
+            result.indices = encodeIndices<uint32_t>(indices);
+        }
+
+        return result;
+    }
+
+    SamplerInfo importSampler(const fastgltf::Asset& asset, const fastgltf::Texture& texture) {
+        const auto& gltfSampler = asset.samplers.at(texture.samplerIndex.value());
+        auto [minFilter, minMipmapMode] =
+            getSamplerFilterInfo(gltfSampler.minFilter.value_or(fastgltf::Filter::Nearest));
+        auto [magFilter, _] = getSamplerFilterInfo(gltfSampler.magFilter.value_or(fastgltf::Filter::Nearest));
+
+        return SamplerInfo{.magFilter = magFilter, .minFilter = minFilter, .mipmapMode = minMipmapMode};
+    }
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "renderer/gpu_data.h"
+#include "renderer/loaded_gltf.h"
+#include "renderer/sampler_cache.h"
+#include "renderer/vertex.h"
+#include "renderer/vulkan_usage.h"
+#include "pch.h"
+#include <fastgltf/types.hpp>
+
+// Conversion of glTF data into the engine's CPU-side representation. Shared by
+// the runtime loader and yuubi-cook, so it must not touch the device.
+namespace yuubi {
+
+    // Bump when the output of the importer changes, so meshes cached by an
+    // older version are imported again.
+    constexpr uint32_t importerVersion = 5;
+
+    // glTF texture indices used by a material.
+    struct MaterialTextures {
+        std::optional<size_t> normal;
+        std::optional<size_t> albedo;
+        std::optional<size_t> metallicRoughness;
+    };
+
+    struct ImportedMaterial {
+        // Texture handles are left at the error texture. They are resolved
+        // from textures once the textures are resident.
+        MaterialData data;
+        MaterialTextures textures;
+        bool transparent = false;
+    };
+
+    // Geometry of a mesh, ready to be copied into its vertex and index buffers.
+    struct MeshView {
+        std::string_view name;
+        GeometryFormat format;
+        std::span<const std::byte> vertices;
+        std::span<const std::byte> indices;
+        std::span<const GeoSurface> surfaces;
+    };
+
+    struct ImportedMesh {
+        std::string name;
+        GeometryFormat format;
+        // Encoded as described by format.
+        std::vector<std::byte> vertices;
+        std::vector<std::byte> indices;
+        std::vector<GeoSurface> surfaces;
+        // Accessor bytes the mesh was converted from, for throughput stats.
+        size_t sourceBytes = 0;
+
+        [[nodiscard]] MeshView view() const { return {name, format, vertices, indices, surfaces}; }
+    };
+
+    struct ImportedNode {
+        std::string name;
+        std::optional<size_t> mesh;
+        glm::mat4 localTransform{1.0f};
+        std::vector<size_t> children;
+    };
+
+    [[nodiscard]] std::vector<ImportedMaterial> importMaterials(const fastgltf::Asset& asset);
+    [[nodiscard]] std::vector<ImportedNode> importNodes(const fastgltf::Asset& asset);
+    // Interleaves the mesh's attributes into one vertex and index stream and
+    // generates tangents for primitives that have none. Each primitive is
+    // processed on the job system and optimized with meshoptimizer: identical
+    // vertices are welded, and triangles and vertices are reordered for the
+    // post-transform cache, overdraw and fetch locality. Vertices are encoded
+    // in vertexFormat, where Compact stands for CompactColor if the mesh has
+    // vertex colors, and indices are 16-bit when they fit.
+    [[nodiscard]] ImportedMesh importMesh(
+        const fastgltf::Asset& asset, const fastgltf::Mesh& mesh, std::span<const ImportedMaterial> materials,
+        VertexFormat vertexFormat
+    );
+    [[nodiscard]] SamplerInfo importSampler(const fastgltf::Asset& asset, const fastgltf::Texture& texture);
+
+}
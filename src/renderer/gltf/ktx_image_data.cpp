@@ -0,0 +1,136 @@
+#include "renderer/gltf/ktx_image_data.h"
+
+#include <ktx.h>
+
+namespace {
+
+    constexpr std::array<unsigned char, 12> ktx2Identifier{0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32,
+                                                           0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+    std::pair<ktx_transcode_fmt_e, vk::Format> getTranscodeFormat(yuubi::TextureRole role, bool blockCompression) {
+        if (!blockCompression) {
+            return {
+                KTX_TTF_RGBA32,
+                role == yuubi::TextureRole::Color ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm
+            };
+        }
+
+        switch (role) {
+            case yuubi::TextureRole::SingleChannel:
+                return {KTX_TTF_BC4_R, vk::Format::eBc4UnormBlock};
+            case yuubi::TextureRole::Normal:
+                return {KTX_TTF_BC5_RG, vk::Format::eBc5UnormBlock};
+            case yuubi::TextureRole::Data:
+                return {KTX_TTF_BC7_RGBA, vk::Format::eBc7UnormBlock};
+            case yuubi::TextureRole::Color:
+                return {KTX_TTF_BC7_RGBA, vk::Format::eBc7SrgbBlock};
+        }
+
+        throw std::runtime_error{"Unsupported texture role"};
+    }
+
+    bool isBlockCompressed(vk::Format format) {
+        return format >= vk::Format::eBc1RgbUnormBlock && format <= vk::Format::eBc7SrgbBlock;
+    }
+
+}
+
+namespace yuubi {
+
+    KtxImageData::KtxImageData(std::span<const unsigned char> bytes, TextureRole role, bool blockCompression) {
+        ktxTexture2* texture = nullptr;
+        const auto result =
+            ktxTexture2_CreateFromMemory(bytes.data(), bytes.size(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture);
+        if (result != KTX_SUCCESS) {
+            UB_ERROR("Unable to load KTX2 image: {}", ktxErrorString(result));
+            return;
+        }
+
+        *this = KtxImageData(texture, role, blockCompression);
+    }
+
+    KtxImageData::KtxImageData(ktxTexture2* texture, TextureRole role, bool blockCompression) : texture_(texture) {
+        if (ktxTexture2_NeedsTranscoding(texture_)) {
+            const auto [transcodeFormat, format] = getTranscodeFormat(role, blockCompression);
+            const auto result = ktxTexture2_TranscodeBasis(texture_, transcodeFormat, 0);
+            if (result != KTX_SUCCESS) {
+                UB_ERROR("Unable to transcode KTX2 image: {}", ktxErrorString(result));
+                ktxTexture_Destroy(ktxTexture(std::exchange(texture_, nullptr)));
+                return;
+            }
+            format_ = format;
+        } else {
+            format_ = static_cast<vk::Format>(texture_->vkFormat);
+            if (format_ == vk::Format::eUndefined) {
+                UB_ERROR("KTX2 image has no Vulkan format");
+                ktxTexture_Destroy(ktxTexture(std::exchange(texture_, nullptr)));
+                return;
+            }
+            if (!blockCompression && isBlockCompressed(format_)) {
+                UB_ERROR("KTX2 image is block-compressed, which the device doesn't support");
+                ktxTexture_Destroy(ktxTexture(std::exchange(texture_, nullptr)));
+                return;
+            }
+        }
+
+        for (uint32_t level = 0; level < texture_->numLevels; level++) {
+            ktx_size_t offset = 0;
+            ktxTexture_GetImageOffset(ktxTexture(texture_), level, 0, 0, &offset);
+            mipLevels_.push_back({.offset = offset, .size = ktxTexture_GetImageSize(ktxTexture(texture_), level)});
+        }
+    }
+
+    KtxImageData::KtxImageData(KtxImageData&& rhs) noexcept :
+        texture_(std::exchange(rhs.texture_, nullptr)), format_(std::exchange(rhs.format_, vk::Format::eUndefined)),
+        mipLevels_(std::move(rhs.mipLevels_)) {}
+
+    KtxImageData& KtxImageData::operator=(KtxImageData&& rhs) noexcept {
+        if (this != &rhs) {
+            std::swap(texture_, rhs.texture_);
+            std::swap(format_, rhs.format_);
+            std::swap(mipLevels_, rhs.mipLevels_);
+        }
+
+        return *this;
+    }
+
+    KtxImageData::~KtxImageData() {
+        if (texture_ != nullptr) {
+            ktxTexture_Destroy(ktxTexture(texture_));
+        }
+    }
+
+    bool KtxImageData::isKtx2(std::span<const unsigned char> bytes) {
+        return bytes.size() >= ktx2Identifier.size() &&
+               std::ranges::equal(bytes.first(ktx2Identifier.size()), ktx2Identifier);
+    }
+
+    ImageData KtxImageData::imageData() const {
+        if (texture_ == nullptr) {
+            return ImageData{.pixels = nullptr, .width = 0, .height = 0, .numChannels = 0, .format = format_};
+        }
+
+        return ImageData{
+            .pixels = ktxTexture_GetData(ktxTexture(texture_)),
+            .width = texture_->baseWidth,
+            .height = texture_->baseHeight,
+            .numChannels = 4,
+            .format = format_,
+            .mipLevels = mipLevels_
+        };
+    }
+
+    bool KtxImageData::writeToFile(const std::filesystem::path& path) const {
+        if (texture_ == nullptr) {
+            return false;
+        }
+
+        const auto result = ktxTexture2_WriteToNamedFile(texture_, path.string().c_str());
+        if (result != KTX_SUCCESS) {
+            UB_ERROR("Unable to write KTX2 image {}: {}", path.string(), ktxErrorString(result));
+            return false;
+        }
+        return true;
+    }
+
+}
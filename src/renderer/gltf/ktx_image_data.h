@@ -0,0 +1,54 @@
+#pragma once
+
+#include "core/util.h"
+#include "renderer/vma/image.h"
+#include "renderer/vulkan_usage.h"
+#include "pch.h"
+
+struct ktxTexture2;
+
+namespace yuubi {
+
+    // How a material samples a texture. Decides the block-compressed format
+    // Basis Universal textures are transcoded to. Devices without BCn get
+    // RGBA8 instead, sRGB for color.
+    enum class TextureRole {
+        // Single channel data such as occlusion. Transcoded to BC4.
+        SingleChannel,
+        // Tangent space normals. Transcoded to BC5, which only keeps X and Y,
+        // so shaders reconstruct Z.
+        Normal,
+        // Linear data such as metallic-roughness. Transcoded to BC7.
+        Data,
+        // sRGB color. Transcoded to BC7.
+        Color,
+    };
+
+    // A KTX2 image with its mip chain. Basis Universal (KHR_texture_basisu)
+    // images are transcoded on load, to BCn if blockCompression is set and
+    // to RGBA8 otherwise. Other images are used as stored, and fail to load
+    // if they are BCn and blockCompression isn't set.
+    class KtxImageData : NonCopyable {
+    public:
+        KtxImageData() = default;
+        KtxImageData(std::span<const unsigned char> bytes, TextureRole role, bool blockCompression = true);
+        // Takes ownership of texture.
+        KtxImageData(ktxTexture2* texture, TextureRole role, bool blockCompression = true);
+        KtxImageData(KtxImageData&& rhs) noexcept;
+        KtxImageData& operator=(KtxImageData&& rhs) noexcept;
+        ~KtxImageData();
+
+        [[nodiscard]] static bool isKtx2(std::span<const unsigned char> bytes);
+
+        // Pixels are null if the image failed to load.
+        [[nodiscard]] ImageData imageData() const;
+
+        bool writeToFile(const std::filesystem::path& path) const;
+
+    private:
+        ktxTexture2* texture_ = nullptr;
+        vk::Format format_ = vk::Format::eUndefined;
+        std::vector<ImageMipLevel> mipLevels_;
+    };
+
+}
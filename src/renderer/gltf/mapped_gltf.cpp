@@ -0,0 +1,102 @@
+#include "renderer/gltf/mapped_gltf.h"
+
+#include <fastgltf/core.hpp>
+
+namespace {
+
+    // Returns the binary chunk of a .glb file, or nothing if bytes aren't a
+    // .glb with one.
+    std::optional<std::span<const std::byte>> glbBinaryChunk(std::span<const std::byte> bytes) {
+        constexpr uint32_t glbMagic = 0x46546c67;
+        constexpr uint32_t binaryChunkType = 0x004e4942;
+        constexpr size_t headerSize = 12;
+        constexpr size_t chunkHeaderSize = 8;
+
+        const auto readWord = [&bytes](size_t offset) {
+            uint32_t word = 0;
+            std::memcpy(&word, bytes.data() + offset, sizeof(word));
+            return word;
+        };
+
+        if (bytes.size() < headerSize + chunkHeaderSize || readWord(0) != glbMagic) {
+            return std::nullopt;
+        }
+
+        // The JSON chunk always comes first.
+        const size_t binaryHeader = headerSize + chunkHeaderSize + readWord(headerSize);
+        if (binaryHeader + chunkHeaderSize > bytes.size() || readWord(binaryHeader + 4) != binaryChunkType) {
+            return std::nullopt;
+        }
+        const size_t length = readWord(binaryHeader);
+        if (binaryHeader + chunkHeaderSize + length > bytes.size()) {
+            return std::nullopt;
+        }
+        return bytes.subspan(binaryHeader + chunkHeaderSize, length);
+    }
+
+    fastgltf::sources::ByteView byteView(std::span<const std::byte> bytes) {
+        return {.bytes = {bytes.data(), bytes.size()}, .mimeType = fastgltf::MimeType::GltfBuffer};
+    }
+
+}
+
+namespace yuubi {
+
+    std::optional<MappedGltf> MappedGltf::load(const std::filesystem::path& path) {
+        auto data = fastgltf::MappedGltfFile::FromPath(path);
+        if (data.error() != fastgltf::Error::None) {
+            UB_ERROR("Unable to load file: {}", path.string());
+            return std::nullopt;
+        }
+
+        // External buffers are left as URIs and mapped below instead of being
+        // read by fastgltf.
+        fastgltf::Parser parser(fastgltf::Extensions::KHR_texture_basisu);
+        constexpr auto gltfOptions = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::AllowDouble;
+        auto loadedGltf = parser.loadGltf(data.get(), path.parent_path(), gltfOptions);
+        if (const auto error = loadedGltf.error(); error != fastgltf::Error::None) {
+            UB_ERROR("Unable to parse file: {} ({})", path.string(), fastgltf::getErrorMessage(error));
+            return std::nullopt;
+        }
+
+        MappedGltf gltf;
+        gltf.asset_ = std::move(loadedGltf.get());
+
+        for (auto& buffer: gltf.asset_.buffers) {
+            const auto* uri = std::get_if<fastgltf::sources::URI>(&buffer.data);
+            if (uri == nullptr) {
+                continue;
+            }
+
+            if (!uri->uri.isLocalPath()) {
+                UB_ERROR("Unsupported buffer URI in {}: {}", path.string(), uri->uri.string());
+                return std::nullopt;
+            }
+            const auto bufferPath = path.parent_path() / uri->uri.fspath();
+            auto file = MappedFile(bufferPath);
+            const auto bytes = std::as_bytes(file.bytes());
+            if (uri->fileByteOffset + buffer.byteLength > bytes.size()) {
+                UB_ERROR("Unable to load buffer: {}", bufferPath.string());
+                return std::nullopt;
+            }
+
+            buffer.data = byteView(bytes.subspan(uri->fileByteOffset, buffer.byteLength));
+            gltf.files_.push_back(std::move(file));
+        }
+
+        // fastgltf copies the binary chunk of a .glb into the first buffer.
+        // That copy only lives until it is swapped for a view of the file.
+        if (!gltf.asset_.buffers.empty() &&
+            !std::holds_alternative<fastgltf::sources::ByteView>(gltf.asset_.buffers[0].data)) {
+            auto file = MappedFile(path);
+            const auto chunk = glbBinaryChunk(std::as_bytes(file.bytes()));
+            if (chunk.has_value() && gltf.asset_.buffers[0].byteLength <= chunk->size()) {
+                gltf.asset_.buffers[0].data = byteView(chunk->first(gltf.asset_.buffers[0].byteLength));
+                gltf.files_.push_back(std::move(file));
+            }
+        }
+
+        return gltf;
+    }
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "core/io/mapped_file.h"
+#include "pch.h"
+#include <fastgltf/types.hpp>
+
+namespace yuubi {
+
+    // A glTF asset whose buffers are read in place. The .gltf or .glb file is
+    // parsed from a memory mapping, and every external .bin file and the
+    // binary chunk of a .glb are mapped as well and handed to fastgltf as
+    // ByteViews. Accessors and images stored in buffer views are then read
+    // straight from the page cache rather than from heap copies of the
+    // buffers, which the OS can drop again under memory pressure.
+    //
+    // Buffers embedded as data URIs are still decoded to the heap by fastgltf.
+    class MappedGltf : NonCopyable {
+    public:
+        // Logs and returns nothing if the file or one of its buffers can't be
+        // loaded.
+        [[nodiscard]] static std::optional<MappedGltf> load(const std::filesystem::path& path);
+
+        [[nodiscard]] const fastgltf::Asset& asset() const { return asset_; }
+
+    private:
+        MappedGltf() = default;
+
+        fastgltf::Asset asset_;
+        // Backing the ByteViews in asset_. Moving the files doesn't move
+        // their mappings.
+        std::vector<MappedFile> files_;
+    };
+
+}
@@ -0,0 +1,74 @@
+#include "renderer/gltf/mesh_cache.h"
+
+#include "core/hash.h"
+#include "core/io/mapped_file.h"
+#include "renderer/gltf/cooked_asset.h"
+#include "renderer/gltf/import.h"
+#include <fastgltf/core.hpp>
+#include <thread>
+
+namespace yuubi {
+
+    std::filesystem::path meshCachePath(
+        const std::filesystem::path& gltfPath, const fastgltf::Asset& asset, VertexFormat vertexFormat
+    ) {
+        std::error_code error;
+        const auto cacheDir = std::filesystem::temp_directory_path(error) / "yuubi" / "meshes";
+        if (error) {
+            return {};
+        }
+
+        uint64_t key = hashCombine(importerVersion, cookedAssetVersion);
+        key = hashCombine(key, static_cast<uint64_t>(vertexFormat));
+        key = hashBytes(MappedFile(gltfPath).bytes(), key);
+
+        // External and embedded buffers alike are loaded or mapped by now. A
+        // .glb buffer gets hashed twice, which is cheap next to importing it.
+        const auto hashBuffer = [&key](const auto* bytes, size_t size) {
+            key = hashBytes({reinterpret_cast<const char*>(bytes), size}, key);
+        };
+        for (const auto& buffer: asset.buffers) {
+            std::visit(
+                fastgltf::visitor{
+                    [](const auto&) {},
+                    [&](const fastgltf::sources::Array& array) { hashBuffer(array.bytes.data(), array.bytes.size()); },
+                    [&](const fastgltf::sources::ByteView& view) { hashBuffer(view.bytes.data(), view.bytes.size()); }
+                },
+                buffer.data
+            );
+        }
+
+        return cacheDir / std::format("{}-{:016x}{}", gltfPath.stem().string(), key, cookedAssetExtension);
+    }
+
+    bool writeMeshCache(
+        const std::filesystem::path& path, std::span<const ImportedMesh> meshes, std::vector<ImportedNode>&& nodes
+    ) {
+        const CookedAsset asset{
+            .meshes = meshes | std::views::transform(&ImportedMesh::view) | std::ranges::to<std::vector>(),
+            .nodes = std::move(nodes),
+        };
+
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+
+        // Written beside the entry and renamed over it once complete.
+        auto partialPath = path;
+        partialPath += std::format(".{}", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        if (error || !writeCookedAsset(partialPath, asset)) {
+            std::filesystem::remove(partialPath, error);
+            return false;
+        }
+
+        std::filesystem::rename(partialPath, path, error);
+        if (error) {
+            UB_ERROR("Unable to write mesh cache: {}", path.string());
+            std::filesystem::remove(partialPath, error);
+            return false;
+        }
+
+        UB_INFO("Cached meshes in {}", path.string());
+        return true;
+    }
+
+}
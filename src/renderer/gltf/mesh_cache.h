@@ -0,0 +1,26 @@
+#pragma once
+
+#include "renderer/gltf/import.h"
+#include "pch.h"
+#include <fastgltf/types.hpp>
+
+namespace yuubi {
+
+    // Imported meshes and nodes of glTF files are cached on disk as cooked
+    // packages without materials or textures, so loading an unchanged file
+    // again skips accessor conversion and tangent generation.
+    //
+    // Entries are keyed by the contents of the file and its buffers, the
+    // vertex format meshes are imported with, and the importer and package
+    // versions. A stale entry is never looked up again. Returns an empty path
+    // if there is nowhere to cache.
+    [[nodiscard]] std::filesystem::path meshCachePath(
+        const std::filesystem::path& gltfPath, const fastgltf::Asset& asset, VertexFormat vertexFormat
+    );
+    // Writes the entry at path. Concurrent writers and readers of the same
+    // entry never see a partial file.
+    bool writeMeshCache(
+        const std::filesystem::path& path, std::span<const ImportedMesh> meshes, std::vector<ImportedNode>&& nodes
+    );
+
+}
@@ -1,133 +1,158 @@
 #include "renderer/gltf/thread.h"
 
 #include <fastgltf/core.hpp>
-#include <stb_image.h>
+#include <fastgltf/tools.hpp>
 #include "pch.h"
+#include "core/hash.h"
+#include "core/io/mapped_file.h"
+#include "core/job_system.h"
 #include "renderer/vma/image.h"
 #include "renderer/resources/texture_manager.h"
-#include <thread>
 #include "renderer/device.h"
 #include <glm/glm.hpp>
 #include "renderer/vulkan/util.h"
-#include <future>
+#include <functional>
 
 namespace {
-    std::unordered_set<std::size_t> getSrgbImageIndices(std::span<const fastgltf::Material> materials) {
-        std::unordered_set<std::size_t> indices;
-
-        for (const auto& material: materials) {
-            if (const auto& baseColorTexture = material.pbrData.baseColorTexture) {
-                indices.emplace(baseColorTexture->textureIndex);
-            }
-            if (const auto& emissiveTexture = material.emissiveTexture) {
-                indices.emplace(emissiveTexture->textureIndex);
-            }
+    yuubi::TextureImageData readImage(
+        std::span<const unsigned char> bytes, yuubi::TextureRole role, bool blockCompression
+    ) {
+        if (yuubi::KtxImageData::isKtx2(bytes)) {
+            return yuubi::KtxImageData(bytes, role, blockCompression);
         }
-
-        return indices;
+        return yuubi::DecodedImageData(bytes, role);
     }
 
-    yuubi::StbImageData loadImageData(
-        const fastgltf::Asset& asset, const fastgltf::Image& image, const std::filesystem::path& assetDir, bool srgb
+    // Calls use with the encoded bytes of image, straight from the mapped file
+    // or buffer. Sources that can't be read are skipped.
+    // Mostly taken from
+    // https://github.com/spnda/fastgltf/blob/main/examples/gl_viewer/gl_viewer.cpp
+    void visitImageBytes(
+        const fastgltf::Asset& asset, const fastgltf::Image& image, const std::filesystem::path& assetDir,
+        const std::function<void(std::span<const unsigned char>)>& use
     ) {
-        yuubi::StbImageData data;
-        // Mostly taken from
-        // https://github.com/spnda/fastgltf/blob/main/examples/gl_viewer/gl_viewer.cpp
+        const auto useBytes = [&use](const auto* bytes, size_t size) {
+            use({reinterpret_cast<const unsigned char*>(bytes), size});
+        };
+
         std::visit(
             fastgltf::visitor{
-                [](auto&) {},
-                [&assetDir, srgb, &data](const fastgltf::sources::URI& filePath) {
+                [](const auto&) {},
+                [&](const fastgltf::sources::URI& filePath) {
                     assert(filePath.fileByteOffset == 0); // Byte offsets are unsupported.
                     assert(filePath.uri.isLocalPath());
-                    const std::string pathString = (assetDir / filePath.uri.fspath()).string();
-                    data = yuubi::StbImageData(pathString, srgb);
-                },
-                [srgb, &data](fastgltf::sources::Array& vector) {
-                    const std::span bytes{reinterpret_cast<unsigned char*>(vector.bytes.data()), vector.bytes.size()};
-                    data = yuubi::StbImageData(bytes, srgb);
+                    const yuubi::MappedFile file(assetDir / filePath.uri.fspath());
+                    useBytes(file.bytes().data(), file.bytes().size());
                 },
-                [&asset, srgb, &data](const fastgltf::sources::BufferView& view) {
-                    auto& bufferView = asset.bufferViews[view.bufferViewIndex];
-                    auto& buffer = asset.buffers[bufferView.bufferIndex];
-
-                    std::visit(
-                        fastgltf::visitor{
-                            [](auto& arg) {},
-                            [srgb, &data](fastgltf::sources::Array& vector) {
-                                const std::span bytes{
-                                    reinterpret_cast<unsigned char*>(vector.bytes.data()), vector.bytes.size()
-                                };
-                                data = yuubi::StbImageData(bytes, srgb);
-                            }
-                        },
-                        buffer.data
-                    );
+                [&](const fastgltf::sources::Array& vector) { useBytes(vector.bytes.data(), vector.bytes.size()); },
+                [&](const fastgltf::sources::BufferView& view) {
+                    const auto bytes = fastgltf::DefaultBufferDataAdapter{}(asset, view.bufferViewIndex);
+                    useBytes(bytes.data(), bytes.size());
                 }
             },
             image.data
         );
-
-        return data;
     }
 
-    std::vector<yuubi::StbImageData> loadImageDataChunk(
-        const fastgltf::Asset& asset, std::span<std::pair<fastgltf::Texture, bool>> images,
-        const std::filesystem::path& assetDir
+    std::vector<yuubi::TextureImageData> loadAllImageData(
+        const fastgltf::Asset& asset, const std::filesystem::path& assetDir
     ) {
-        return images | std::views::transform([&asset, assetDir](auto&& imageSrgbPair) {
-                   const auto [texture, srgb] = imageSrgbPair;
-                   const auto& image = asset.images.at(texture.imageIndex.value());
-                   return loadImageData(asset, image, assetDir, srgb);
-               }) |
-               std::ranges::to<std::vector<yuubi::StbImageData>>();
+        const auto roles = yuubi::getImageRoles(asset);
+
+        // Images vary wildly in size, so decode each one as its own job and let
+        // idle workers steal the rest.
+        std::vector<yuubi::TextureImageData> result(asset.images.size());
+        yuubi::JobSystem::get().parallelFor(asset.images.size(), [&](size_t i) {
+            if (roles[i].has_value()) {
+                result[i] = yuubi::loadImage(asset, i, assetDir, *roles[i]);
+            }
+        });
+
+        return result;
     }
 
-    std::vector<yuubi::StbImageData> loadAllImageData(
-        const fastgltf::Asset& asset, const std::filesystem::path& assetDir
-    ) {
-        auto srgbImageIndices = getSrgbImageIndices(asset.materials);
-
-        auto imageSrgbPair =
-            std::views::enumerate(asset.textures) |
-            std::views::transform([&asset, &srgbImageIndices](auto&& indexTexturePair) {
-                const auto& [i, fastgltfTexture] = indexTexturePair;
-                const auto& fastgltfImage = asset.images.at(fastgltfTexture.imageIndex.value());
-                return std::pair<fastgltf::Texture, bool>{fastgltfTexture, srgbImageIndices.contains(i)};
-            }) |
-            std::ranges::to<std::vector<std::pair<fastgltf::Texture, bool>>>();
-
-        const int numThreads = std::thread::hardware_concurrency();
-        const int chunkSize = imageSrgbPair.size() / numThreads;
-        int remainder = imageSrgbPair.size() % numThreads;
-
-        std::vector<std::future<std::vector<yuubi::StbImageData>>> futures;
-
-        futures.resize(numThreads);
-        int start = 0;
-        for (int i = 0; i < numThreads; ++i) {
-            const int currentChunkSize = chunkSize + (remainder-- > 0 ? 1 : 0);
-
-            std::span pair(imageSrgbPair.data() + start, currentChunkSize);
-            futures[i] = std::async(std::launch::async, [&asset, pair, &assetDir]() {
-                return loadImageDataChunk(asset, pair, assetDir);
-            });
-            start += currentChunkSize;
+}
+
+namespace yuubi {
+    DecodedImageData::DecodedImageData(std::span<const unsigned char> bytes, TextureRole role) :
+        format_(role == TextureRole::Color ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm),
+        mipFilter_(role == TextureRole::Normal ? MipFilter::Normal : MipFilter::Average) {
+        if (auto pixels = decodeImage(bytes)) {
+            pixels_ = std::move(*pixels);
         }
+    }
+
+    ImageData DecodedImageData::imageData() const {
+        return ImageData{
+            .pixels = pixels_.pixels.get(),
+            .width = pixels_.width,
+            .height = pixels_.height,
+            .numChannels = pixels_.numChannels,
+            .format = format_,
+            .mipFilter = mipFilter_,
+        };
+    }
+
+    size_t getTextureImage(const fastgltf::Asset& asset, size_t textureIndex) {
+        const auto& texture = asset.textures[textureIndex];
+        return texture.basisuImageIndex.has_value() ? *texture.basisuImageIndex : texture.imageIndex.value();
+    }
 
-        std::vector<yuubi::StbImageData> result;
-        for (auto& future: futures) {
-            for (auto partialResult = future.get(); auto&& data: partialResult) {
-                result.emplace_back(std::move(data));
+    // Images shared between slots get the role that loses the least
+    // information. Images only sampled outside of materials are treated as
+    // data.
+    std::vector<std::optional<TextureRole>> getImageRoles(const fastgltf::Asset& asset) {
+        std::vector<std::optional<TextureRole>> textureRoles(asset.textures.size());
+        const auto use = [&textureRoles](const auto& textureInfo, TextureRole role) {
+            if (textureInfo.has_value()) {
+                auto& textureRole = textureRoles[textureInfo->textureIndex];
+                textureRole = std::max(textureRole.value_or(role), role);
             }
+        };
+
+        for (const auto& material: asset.materials) {
+            use(material.pbrData.baseColorTexture, TextureRole::Color);
+            use(material.emissiveTexture, TextureRole::Color);
+            use(material.pbrData.metallicRoughnessTexture, TextureRole::Data);
+            use(material.normalTexture, TextureRole::Normal);
+            use(material.occlusionTexture, TextureRole::SingleChannel);
         }
 
-        return result;
+        std::vector<std::optional<TextureRole>> imageRoles(asset.images.size());
+        for (const auto& [i, textureRole]: std::views::enumerate(textureRoles)) {
+            auto& imageRole = imageRoles.at(getTextureImage(asset, i));
+            if (textureRole.has_value()) {
+                imageRole = std::max(imageRole.value_or(*textureRole), *textureRole);
+            }
+        }
+        for (size_t i = 0; i < asset.textures.size(); i++) {
+            auto& imageRole = imageRoles[getTextureImage(asset, i)];
+            imageRole = imageRole.value_or(TextureRole::Data);
+        }
+
+        return imageRoles;
     }
 
-}
+    TextureImageData loadImage(
+        const fastgltf::Asset& asset, size_t imageIndex, const std::filesystem::path& assetDir, TextureRole role,
+        bool blockCompression
+    ) {
+        TextureImageData data;
+        visitImageBytes(asset, asset.images[imageIndex], assetDir, [&](std::span<const unsigned char> bytes) {
+            data = readImage(bytes, role, blockCompression);
+        });
+        return data;
+    }
 
-namespace yuubi {
-    std::vector<StbImageData> loadTextures(const fastgltf::Asset& asset, const std::filesystem::path& assetDir) {
+    uint64_t hashImage(const fastgltf::Asset& asset, size_t imageIndex, const std::filesystem::path& assetDir) {
+        uint64_t hash = 0;
+        visitImageBytes(asset, asset.images[imageIndex], assetDir, [&hash](std::span<const unsigned char> bytes) {
+            hash = hashBytes({reinterpret_cast<const char*>(bytes.data()), bytes.size()});
+        });
+        return hash;
+    }
+
+    std::vector<TextureImageData> loadImages(const fastgltf::Asset& asset, const std::filesystem::path& assetDir) {
         return loadAllImageData(asset, assetDir);
     }
 }
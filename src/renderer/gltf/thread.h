@@ -2,75 +2,53 @@
 
 #include "pch.h"
 #include <fastgltf/types.hpp>
+#include "renderer/gltf/image_decoder.h"
+#include "renderer/gltf/ktx_image_data.h"
 #include "renderer/resources/texture_manager.h"
-#include <stb_image.h>
+#include "renderer/vma/image.h"
 
 
 namespace yuubi {
     class Device;
 
-    class StbImageData : NonCopyable {
+    // An image decoded to 8-bit pixels by one of the ImageDecoders. Pixels
+    // keep the channels they are stored with and are expanded to RGBA on
+    // their way into staging memory.
+    class DecodedImageData : NonCopyable {
     public:
-        StbImageData() = default;
+        DecodedImageData() = default;
+        DecodedImageData(std::span<const unsigned char> bytes, TextureRole role);
 
-        explicit StbImageData(std::string_view path, bool srgb) {
-            data_ = stbi_load(path.data(), &width_, &height_, &numChannels_, 0);
-            format_ = getImageFormat(srgb);
-        }
-
-        explicit StbImageData(std::span<unsigned char> bytes, bool srgb) {
-            data_ = stbi_load_from_memory(bytes.data(), bytes.size(), &width_, &height_, &numChannels_, 4);
-            numChannels_ = 4;
-            format_ = getImageFormat(srgb);
-        }
-
-        [[nodiscard]] unsigned char* data() const { return data_; }
-        [[nodiscard]] uint32_t width() const { return width_; }
-        [[nodiscard]] uint32_t height() const { return height_; }
-        [[nodiscard]] uint32_t numChannels() const { return numChannels_; }
-        [[nodiscard]] vk::Format format() const { return format_; }
-
-        ~StbImageData() { stbi_image_free(data_); }
-
-        StbImageData(StbImageData&& rhs) noexcept :
-            data_(std::exchange(rhs.data_, nullptr)), width_(std::exchange(rhs.width_, 0)),
-            height_(std::exchange(rhs.height_, 0)), numChannels_(std::exchange(rhs.numChannels_, 0)),
-            format_(std::exchange(rhs.format_, {})) {}
-
-        StbImageData& operator=(StbImageData&& rhs) noexcept {
-            if (this != &rhs) {
-                std::swap(data_, rhs.data_);
-                std::swap(width_, rhs.width_);
-                std::swap(height_, rhs.height_);
-                std::swap(numChannels_, rhs.numChannels_);
-                std::swap(format_, rhs.format_);
-            }
-
-            return *this;
-        }
+        // Pixels are null if the image failed to decode.
+        [[nodiscard]] ImageData imageData() const;
 
     private:
-        [[nodiscard]] vk::Format getImageFormat(bool srgb) const {
-            switch (numChannels_) {
-                case 1:
-                    return vk::Format::eR8Unorm;
-                case 2:
-                    return vk::Format::eR8G8Unorm;
-                case 3:
-                case 4:
-                    return srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
-                default:
-                    throw std::runtime_error{"Unsupported image channel"};
-            }
-        }
-
-        unsigned char* data_ = nullptr;
-        int width_ = 0;
-        int height_ = 0;
-        int numChannels_ = 0;
-        vk::Format format_;
+        DecodedPixels pixels_;
+        // Gray images are read as RGB by glTF, and RGB formats are poorly
+        // supported with optimal tiling, so every image ends up RGBA.
+        vk::Format format_ = vk::Format::eR8G8B8A8Unorm;
+        MipFilter mipFilter_ = MipFilter::Average;
     };
 
-    std::vector<StbImageData> loadTextures(const fastgltf::Asset& asset, const std::filesystem::path& assetDir);
+    using TextureImageData = std::variant<DecodedImageData, KtxImageData>;
+
+    // Index of the image a texture samples, preferring its
+    // KHR_texture_basisu image when there is one.
+    size_t getTextureImage(const fastgltf::Asset& asset, size_t textureIndex);
+    // Picks the role of each image from the material slots its textures are
+    // used in. Images no texture samples have no role and are never loaded.
+    std::vector<std::optional<TextureRole>> getImageRoles(const fastgltf::Asset& asset);
+    // Loads one image of asset. KTX2 images are kept or transcoded to BCn
+    // only if blockCompression is set.
+    TextureImageData loadImage(
+        const fastgltf::Asset& asset, size_t imageIndex, const std::filesystem::path& assetDir, TextureRole role,
+        bool blockCompression = true
+    );
+    // Hash of the encoded bytes of one image of asset, which identifies it
+    // across assets.
+    uint64_t hashImage(const fastgltf::Asset& asset, size_t imageIndex, const std::filesystem::path& assetDir);
+    // Loads every image sampled by a texture of asset, indexed like
+    // asset.images. Each image is decoded once, however many textures use it.
+    std::vector<TextureImageData> loadImages(const fastgltf::Asset& asset, const std::filesystem::path& assetDir);
 
 }
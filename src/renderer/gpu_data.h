@@ -15,6 +15,8 @@ namespace yuubi {
         glm::vec4 sunlightDirection; // w for sun power
         glm::vec4 sunlightColor;
         vk::DeviceAddress materials;
+        vk::DeviceAddress textureFeedback;
+        vk::DeviceAddress textureSlots;
     };
 
     // PERF: pack this struct appropriately
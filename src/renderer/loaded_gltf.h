@@ -7,8 +7,8 @@
 #include <fastgltf/core.hpp>
 #include <fastgltf/types.hpp>
 #include <fastgltf/tools.hpp>
+#include "renderer/geometry_pool.h"
 #include "renderer/vertex.h"
-#include "renderer/vma/buffer.h"
 
 namespace yuubi {
 
@@ -25,26 +25,31 @@ namespace yuubi {
         MaterialPass passType;
     };
 
-    class Device;
+    // Geometry lives in a GeometryPool, encoded as described by format().
+    // Surface start indices are relative to the mesh, and geometry() gives
+    // where the mesh starts in its block.
     class Mesh : NonCopyable {
     public:
         Mesh() = default;
+        // Takes ownership of geometry, allocated from geometryPool.
         Mesh(
-            std::string name, Device& device, std::span<Vertex> vertices, std::span<uint32_t> indices,
-            std::vector<GeoSurface>&& surfaces
+            std::string name, GeometryPool& geometryPool, const GeometryAllocation& geometry,
+            const GeometryFormat& format, std::vector<GeoSurface>&& surfaces
         );
-        Mesh(Mesh&& rhs) = default;
+        Mesh(Mesh&& rhs) noexcept;
         Mesh& operator=(Mesh&& rhs) noexcept;
+        ~Mesh();
 
-        [[nodiscard]] std::shared_ptr<Buffer> vertexBuffer() const { return vertexBuffer_; }
-        [[nodiscard]] std::shared_ptr<Buffer> indexBuffer() const { return indexBuffer_; }
+        [[nodiscard]] const GeometryFormat& format() const { return format_; }
+        [[nodiscard]] const GeometryAllocation& geometry() const { return geometry_; }
         [[nodiscard]] const std::vector<GeoSurface>& surfaces() const { return surfaces_; }
 
     private:
         std::string name_;
         std::vector<GeoSurface> surfaces_;
-        std::shared_ptr<Buffer> vertexBuffer_;
-        std::shared_ptr<Buffer> indexBuffer_;
+        GeometryFormat format_;
+        GeometryPool* geometryPool_ = nullptr;
+        GeometryAllocation geometry_;
     };
 
 }
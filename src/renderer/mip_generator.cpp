@@ -0,0 +1,325 @@
+#include "renderer/mip_generator.h"
+#include "renderer/device.h"
+#include "renderer/pipeline_builder.h"
+
+namespace {
+
+    // Levels written by one dispatch, and the largest image one dispatch can
+    // write all of them for. Beyond that, the sixth level no longer fits in
+    // the tile of the last workgroup.
+    constexpr uint32_t maxLevelsPerDispatch = 12;
+    constexpr uint32_t maxSinglePassSize = 4096;
+    constexpr uint32_t tileSize = 64;
+
+    // Must match mipgen.comp.
+    enum class FilterMode : uint32_t {
+        Average = 0,
+        Srgb = 1,
+        Normal = 2,
+    };
+
+    struct PushConstants {
+        vk::DeviceAddress counter;
+        uint32_t baseLevel;
+        uint32_t numLevels;
+        FilterMode filterMode;
+        uint32_t numWorkgroups;
+    };
+
+    // Storage images can't be sRGB, so those levels are written through
+    // views of the matching UNORM format and encoded by the shader.
+    vk::Format getStorageFormat(vk::Format format) {
+        switch (format) {
+            case vk::Format::eR8Srgb:
+                return vk::Format::eR8Unorm;
+            case vk::Format::eR8G8Srgb:
+                return vk::Format::eR8G8Unorm;
+            case vk::Format::eR8G8B8A8Srgb:
+                return vk::Format::eR8G8B8A8Unorm;
+            case vk::Format::eB8G8R8A8Srgb:
+                return vk::Format::eB8G8R8A8Unorm;
+            default:
+                return format;
+        }
+    }
+
+    struct Dispatch {
+        size_t request;
+        uint32_t baseLevel;
+        uint32_t numLevels;
+    };
+
+}
+
+namespace yuubi {
+
+    MipGenerator::MipGenerator(const Device& device) : device_(&device) {
+        const auto& vkDevice = device_->getDevice();
+
+        sampler_ = vkDevice.createSampler(vk::SamplerCreateInfo{
+            .magFilter = vk::Filter::eNearest,
+            .minFilter = vk::Filter::eNearest,
+            .mipmapMode = vk::SamplerMipmapMode::eNearest,
+            .maxLod = vk::LodClampNone,
+        });
+
+        const std::array bindings{
+            vk::DescriptorSetLayoutBinding{
+                                           .binding = 0,
+                                           .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                           .descriptorCount = 1,
+                                           .stageFlags = vk::ShaderStageFlagBits::eCompute,
+                                           .pImmutableSamplers = &*sampler_
+            },
+            vk::DescriptorSetLayoutBinding{
+                                           .binding = 1,
+                                           .descriptorType = vk::DescriptorType::eStorageImage,
+                                           .descriptorCount = maxLevelsPerDispatch,
+                                           .stageFlags = vk::ShaderStageFlagBits::eCompute
+            },
+        };
+        descriptorSetLayout_ = vkDevice.createDescriptorSetLayout(
+            {.bindingCount = static_cast<uint32_t>(bindings.size()), .pBindings = bindings.data()}
+        );
+
+        std::array layouts{*descriptorSetLayout_};
+        std::array pushConstantRanges{
+            vk::PushConstantRange{
+                                  .stageFlags = vk::ShaderStageFlagBits::eCompute,
+                                  .offset = 0,
+                                  .size = sizeof(PushConstants)
+            }
+        };
+        pipelineLayout_ = createPipelineLayout(*device_, layouts, pushConstantRanges);
+
+        const auto shader = loadShader("shaders/mipgen.comp.spv", *device_);
+        pipeline_ = vkDevice.createComputePipeline(
+            nullptr, vk::ComputePipelineCreateInfo{
+                         .stage =
+                             {.stage = vk::ShaderStageFlagBits::eCompute, .module = *shader, .pName = "main"},
+                         .layout = *pipelineLayout_
+                     }
+        );
+    }
+
+    bool MipGenerator::supportsFormat(vk::Format format) const {
+        const auto& physicalDevice = device_->getPhysicalDevice();
+        const auto sampled = physicalDevice.getFormatProperties(format).optimalTilingFeatures;
+        const auto storage = physicalDevice.getFormatProperties(getStorageFormat(format)).optimalTilingFeatures;
+        return (sampled & vk::FormatFeatureFlagBits::eSampledImage) &&
+               (storage & vk::FormatFeatureFlagBits::eStorageImage);
+    }
+
+    MipGenerator::ImageRequirements MipGenerator::imageRequirements(vk::Format format) {
+        const auto storageFormat = getStorageFormat(format);
+        if (storageFormat == format) {
+            return {.usage = vk::ImageUsageFlagBits::eStorage};
+        }
+
+        // The image's own format doesn't support storage, which extended
+        // usage allows as long as no view of that format has storage usage.
+        // Views used for sampling must therefore restrict their usage.
+        return {
+            .usage = vk::ImageUsageFlagBits::eStorage,
+            .flags = vk::ImageCreateFlagBits::eMutableFormat | vk::ImageCreateFlagBits::eExtendedUsage,
+            .viewFormats = {format, storageFormat}
+        };
+    }
+
+    MipGenerator::Resources MipGenerator::record(
+        const vk::raii::CommandBuffer& commandBuffer, std::span<const Request> requests
+    ) const {
+        // Images too large for one dispatch take several, each reading the
+        // last level written by the one before. Dispatches are grouped into
+        // rounds so only rounds need barriers between them.
+        std::vector<std::vector<Dispatch>> rounds;
+        size_t numDispatches = 0;
+        for (const auto& [i, request]: std::views::enumerate(requests)) {
+            uint32_t baseLevel = 0;
+            for (size_t round = 0; baseLevel + 1 < request.mipLevels; round++) {
+                const uint32_t size = std::max(request.width, request.height) >> baseLevel;
+                const uint32_t numLevels =
+                    std::min(request.mipLevels - 1 - baseLevel, size > maxSinglePassSize ? 6 : maxLevelsPerDispatch);
+
+                if (rounds.size() <= round) {
+                    rounds.emplace_back();
+                }
+                rounds[round].push_back(
+                    {.request = static_cast<size_t>(i), .baseLevel = baseLevel, .numLevels = numLevels}
+                );
+                baseLevel += numLevels;
+                numDispatches++;
+            }
+        }
+
+        Resources resources;
+        if (numDispatches == 0) {
+            return resources;
+        }
+
+        const auto& vkDevice = device_->getDevice();
+
+        const std::array poolSizes{
+            vk::DescriptorPoolSize{.type = vk::DescriptorType::eCombinedImageSampler,
+                                   .descriptorCount = static_cast<uint32_t>(numDispatches)},
+            vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageImage,
+                                   .descriptorCount = static_cast<uint32_t>(numDispatches) * maxLevelsPerDispatch},
+        };
+        resources.descriptorPool = vkDevice.createDescriptorPool({
+            .maxSets = static_cast<uint32_t>(numDispatches),
+            .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+            .pPoolSizes = poolSizes.data(),
+        });
+
+        // One view of each image to read from, and one per level to write.
+        std::vector<size_t> firstViews;
+        for (const auto& request: requests) {
+            firstViews.push_back(resources.imageViews.size());
+
+            // Views of a format without storage support must not inherit
+            // the image's storage usage.
+            vk::ImageViewUsageCreateInfo viewUsage{.usage = vk::ImageUsageFlagBits::eSampled};
+            vk::ImageViewCreateInfo viewInfo{
+                .pNext = &viewUsage,
+                .image = request.image,
+                .viewType = vk::ImageViewType::e2D,
+                .format = request.format,
+                .subresourceRange = {
+                                     .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                     .baseMipLevel = 0,
+                                     .levelCount = request.mipLevels,
+                                     .baseArrayLayer = 0,
+                                     .layerCount = 1
+                }
+            };
+            resources.imageViews.push_back(vkDevice.createImageView(viewInfo));
+
+            viewUsage.usage = vk::ImageUsageFlagBits::eStorage;
+            viewInfo.format = getStorageFormat(request.format);
+            viewInfo.subresourceRange.levelCount = 1;
+            for (uint32_t level = 1; level < request.mipLevels; level++) {
+                viewInfo.subresourceRange.baseMipLevel = level;
+                resources.imageViews.push_back(vkDevice.createImageView(viewInfo));
+            }
+        }
+
+        // Each dispatch counts its finished workgroups in its own slot.
+        resources.counters = device_->createBuffer(
+            {.size = numDispatches * sizeof(uint32_t),
+             .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst |
+                      vk::BufferUsageFlagBits::eShaderDeviceAddress},
+            {.usage = VMA_MEMORY_USAGE_GPU_ONLY}
+        );
+        commandBuffer.fillBuffer(*resources.counters.getBuffer(), 0, vk::WholeSize, 0);
+
+        // Covers both the counter reset and the copies of the base levels.
+        const vk::MemoryBarrier2 uploadBarrier{
+            .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead | vk::AccessFlagBits2::eShaderStorageRead |
+                             vk::AccessFlagBits2::eShaderStorageWrite
+        };
+        commandBuffer.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &uploadBarrier});
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline_);
+
+        const std::vector setLayouts(numDispatches, *descriptorSetLayout_);
+        const auto descriptorSets = (*vkDevice).allocateDescriptorSets({
+            .descriptorPool = *resources.descriptorPool,
+            .descriptorSetCount = static_cast<uint32_t>(setLayouts.size()),
+            .pSetLayouts = setLayouts.data(),
+        });
+
+        size_t setIndex = 0;
+        for (const auto& [round, dispatches]: std::views::enumerate(rounds)) {
+            if (round > 0) {
+                const vk::MemoryBarrier2 roundBarrier{
+                    .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+                    .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+                    .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+                    .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead |
+                                     vk::AccessFlagBits2::eShaderStorageRead |
+                                     vk::AccessFlagBits2::eShaderStorageWrite
+                };
+                commandBuffer.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &roundBarrier});
+            }
+
+            for (const auto& dispatch: dispatches) {
+                const auto& request = requests[dispatch.request];
+                const auto firstView = firstViews[dispatch.request];
+                const auto descriptorSet = descriptorSets[setIndex];
+
+                const vk::DescriptorImageInfo sourceInfo{
+                    .imageView = *resources.imageViews[firstView], .imageLayout = vk::ImageLayout::eGeneral
+                };
+                // Unused slots repeat the last level, which the shader never
+                // writes past.
+                std::array<vk::DescriptorImageInfo, maxLevelsPerDispatch> levelInfos;
+                for (uint32_t i = 0; i < maxLevelsPerDispatch; i++) {
+                    const uint32_t level = std::min(dispatch.baseLevel + 1 + i, request.mipLevels - 1);
+                    levelInfos[i] = {
+                        .imageView = *resources.imageViews[firstView + level], .imageLayout = vk::ImageLayout::eGeneral
+                    };
+                }
+
+                const std::array writes{
+                    vk::WriteDescriptorSet{
+                                           .dstSet = descriptorSet,
+                                           .dstBinding = 0,
+                                           .descriptorCount = 1,
+                                           .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                           .pImageInfo = &sourceInfo
+                    },
+                    vk::WriteDescriptorSet{
+                                           .dstSet = descriptorSet,
+                                           .dstBinding = 1,
+                                           .descriptorCount = maxLevelsPerDispatch,
+                                           .descriptorType = vk::DescriptorType::eStorageImage,
+                                           .pImageInfo = levelInfos.data()
+                    },
+                };
+                vkDevice.updateDescriptorSets(writes, {});
+
+                const uint32_t baseWidth = std::max(request.width >> dispatch.baseLevel, 1u);
+                const uint32_t baseHeight = std::max(request.height >> dispatch.baseLevel, 1u);
+                const uint32_t groupsX = (baseWidth + tileSize - 1) / tileSize;
+                const uint32_t groupsY = (baseHeight + tileSize - 1) / tileSize;
+
+                FilterMode filterMode = FilterMode::Average;
+                if (request.filter == MipFilter::Normal) {
+                    filterMode = FilterMode::Normal;
+                } else if (getStorageFormat(request.format) != request.format) {
+                    filterMode = FilterMode::Srgb;
+                }
+
+                const PushConstants pushConstants{
+                    .counter = resources.counters.getAddress() + setIndex * sizeof(uint32_t),
+                    .baseLevel = dispatch.baseLevel,
+                    .numLevels = dispatch.numLevels,
+                    .filterMode = filterMode,
+                    .numWorkgroups = groupsX * groupsY,
+                };
+
+                commandBuffer.bindDescriptorSets(
+                    vk::PipelineBindPoint::eCompute, *pipelineLayout_, 0, {descriptorSet}, {}
+                );
+                commandBuffer.pushConstants<PushConstants>(
+                    *pipelineLayout_, vk::ShaderStageFlagBits::eCompute, 0, {pushConstants}
+                );
+                commandBuffer.dispatch(groupsX, groupsY, 1);
+                setIndex++;
+            }
+        }
+
+        const vk::MemoryBarrier2 doneBarrier{
+            .srcStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+            .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+            .dstAccessMask = vk::AccessFlagBits2::eMemoryRead
+        };
+        commandBuffer.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &doneBarrier});
+
+        return resources;
+    }
+
+}
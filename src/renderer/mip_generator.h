@@ -0,0 +1,68 @@
+#pragma once
+
+#include "core/util.h"
+#include "renderer/vma/buffer.h"
+#include "renderer/vma/image.h"
+#include "renderer/vulkan_usage.h"
+#include "pch.h"
+
+namespace yuubi {
+
+    class Device;
+
+    // Generates mip chains with a compute shader modelled on AMD's single pass
+    // downsampler. One dispatch writes up to twelve levels of an image (all of
+    // them for images up to 4096x4096), and the dispatches of any number of
+    // images are recorded back to back without barriers between them.
+    //
+    // Images must be created with the usage and flags from imageRequirements().
+    class MipGenerator : NonCopyableOrMovable {
+    public:
+        struct Request {
+            vk::Image image;
+            vk::Format format;
+            uint32_t width;
+            uint32_t height;
+            uint32_t mipLevels;
+            MipFilter filter;
+        };
+
+        // Views, descriptors and counters used by recorded dispatches. Must be
+        // kept alive until they have completed.
+        struct Resources {
+            vk::raii::DescriptorPool descriptorPool = nullptr;
+            std::vector<vk::raii::ImageView> imageViews;
+            Buffer counters;
+        };
+
+        struct ImageRequirements {
+            vk::ImageUsageFlags usage;
+            vk::ImageCreateFlags flags;
+            // Empty unless the image needs views of another format.
+            std::vector<vk::Format> viewFormats;
+        };
+
+        explicit MipGenerator(const Device& device);
+
+        // Whether mips of format can be generated at all. Other formats have
+        // to be blitted.
+        [[nodiscard]] bool supportsFormat(vk::Format format) const;
+        [[nodiscard]] static ImageRequirements imageRequirements(vk::Format format);
+
+        // Records generation of every level past the first of each image. The
+        // base levels must have been written by transfer commands before the
+        // recorded ones, and the generated levels are in the general layout
+        // and visible to all commands after them.
+        [[nodiscard]] Resources record(
+            const vk::raii::CommandBuffer& commandBuffer, std::span<const Request> requests
+        ) const;
+
+    private:
+        const Device* device_;
+        vk::raii::Sampler sampler_ = nullptr;
+        vk::raii::DescriptorSetLayout descriptorSetLayout_ = nullptr;
+        vk::raii::PipelineLayout pipelineLayout_ = nullptr;
+        vk::raii::Pipeline pipeline_ = nullptr;
+    };
+
+}
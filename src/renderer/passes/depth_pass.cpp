@@ -1,6 +1,7 @@
 #include "renderer/passes/depth_pass.h"
 
 #include "renderer/device.h"
+#include "renderer/geometry_pool.h"
 #include "renderer/pipeline_builder.h"
 #include "renderer/viewport.h"
 #include "renderer/push_constants.h"
@@ -49,8 +50,8 @@ namespace yuubi {
     }
 
     void DepthPass::render(
-        const vk::raii::CommandBuffer& commandBuffer, const DrawContext& context, const Buffer& sceneDataBuffer,
-        std::span<vk::DescriptorSet> descriptorSets
+        const vk::raii::CommandBuffer& commandBuffer, const DrawContext& context, const GeometryPool& geometryPool,
+        vk::DeviceAddress sceneDataAddress, std::span<vk::DescriptorSet> descriptorSets
     ) const {
         // Transition depth image
         vk::ImageMemoryBarrier2 depthImageBarrier{
@@ -114,21 +115,33 @@ namespace yuubi {
 
         commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *pipelineLayout_, 0, {descriptorSets}, {});
 
+        // Surfaces of the same geometry block and index type share an index
+        // buffer binding.
+        std::optional<std::pair<uint32_t, vk::IndexType>> boundIndexBuffer;
         // TODO: handle transparent objects
         for (const auto& renderObject: context.opaqueSurfaces) {
-            commandBuffer.bindIndexBuffer(*renderObject.indexBuffer->getBuffer(), 0, vk::IndexType::eUint32);
+            const auto& geometry = geometryPool.block(renderObject.geometryBlock);
+            const auto& format = renderObject.geometryFormat;
+            const std::pair indexBuffer{renderObject.geometryBlock, format.indexType};
+            if (indexBuffer != boundIndexBuffer) {
+                commandBuffer.bindIndexBuffer(*geometry.indexBuffer.getBuffer(), 0, format.indexType);
+                boundIndexBuffer = indexBuffer;
+            }
 
             commandBuffer.pushConstants<PushConstants>(
                 *pipelineLayout_, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0,
                 {
                     PushConstants{
-                                  renderObject.transform, sceneDataBuffer.getAddress(), renderObject.vertexBuffer->getAddress(),
-                                  renderObject.materialId
+                                  renderObject.transform, sceneDataAddress, geometry.vertexBuffer.getAddress(),
+                                  renderObject.materialId, static_cast<uint32_t>(format.vertexFormat),
+                                  format.positionMin, format.positionExtent
                     }
             }
             );
 
-            commandBuffer.drawIndexed(static_cast<uint32_t>(renderObject.indexCount), 1, renderObject.firstIndex, 0, 0);
+            commandBuffer.drawIndexed(
+                renderObject.indexCount, 1, renderObject.firstIndex, renderObject.vertexOffset, 0
+            );
         }
         commandBuffer.endRendering();
     }
@@ -8,6 +8,7 @@
 namespace yuubi {
 
     class Device;
+    class GeometryPool;
     class Viewport;
     class DepthPass : NonCopyable {
     public:
@@ -23,8 +24,8 @@ namespace yuubi {
         DepthPass& operator=(DepthPass&& rhs) noexcept;
 
         void render(
-            const vk::raii::CommandBuffer&, const DrawContext& context, const Buffer& sceneDataBuffer,
-            std::span<vk::DescriptorSet> descriptorSets
+            const vk::raii::CommandBuffer&, const DrawContext& context, const GeometryPool& geometryPool,
+            vk::DeviceAddress sceneDataAddress, std::span<vk::DescriptorSet> descriptorSets
         ) const;
 
     private:
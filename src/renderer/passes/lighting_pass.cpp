@@ -1,5 +1,6 @@
 #include "renderer/passes/lighting_pass.h"
 #include "renderer/device.h"
+#include "renderer/geometry_pool.h"
 #include "renderer/vma/image.h"
 #include "renderer/vma/buffer.h"
 #include "renderer/pipeline_builder.h"
@@ -102,39 +103,62 @@ namespace yuubi {
             vk::PipelineBindPoint::eGraphics, *pipelineLayout_, 0, {renderInfo.descriptorSets}, {}
         );
 
+        // Surfaces of the same geometry block and index type share an index
+        // buffer binding.
+        std::optional<std::pair<uint32_t, vk::IndexType>> boundIndexBuffer;
         for (const auto& renderObject: renderInfo.context.opaqueSurfaces) {
-            commandBuffer.bindIndexBuffer(*renderObject.indexBuffer->getBuffer(), 0, vk::IndexType::eUint32);
+            const auto& geometry = renderInfo.geometryPool.block(renderObject.geometryBlock);
+            const auto& format = renderObject.geometryFormat;
+            const std::pair indexBuffer{renderObject.geometryBlock, format.indexType};
+            if (indexBuffer != boundIndexBuffer) {
+                commandBuffer.bindIndexBuffer(*geometry.indexBuffer.getBuffer(), 0, format.indexType);
+                boundIndexBuffer = indexBuffer;
+            }
 
             commandBuffer.pushConstants<PushConstants>(
                 *pipelineLayout_, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0,
                 {
                     PushConstants{
-                                  renderObject.transform, renderInfo.sceneDataBuffer.getAddress(),
-                                  renderObject.vertexBuffer->getAddress(), renderObject.materialId
+                                  renderObject.transform, renderInfo.sceneDataAddress,
+                                  geometry.vertexBuffer.getAddress(), renderObject.materialId,
+                                  static_cast<uint32_t>(format.vertexFormat), format.positionMin,
+                                  format.positionExtent
                     }
             }
             );
 
-            commandBuffer.drawIndexed(static_cast<uint32_t>(renderObject.indexCount), 1, renderObject.firstIndex, 0, 0);
+            commandBuffer.drawIndexed(
+                renderObject.indexCount, 1, renderObject.firstIndex, renderObject.vertexOffset, 0
+            );
         }
 
         commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *transparentPipeline_);
 
         // TODO: Sort surfaces for correct output
         for (const auto& renderObject: renderInfo.context.transparentSurfaces) {
-            commandBuffer.bindIndexBuffer(*renderObject.indexBuffer->getBuffer(), 0, vk::IndexType::eUint32);
+            const auto& geometry = renderInfo.geometryPool.block(renderObject.geometryBlock);
+            const auto& format = renderObject.geometryFormat;
+            const std::pair indexBuffer{renderObject.geometryBlock, format.indexType};
+            if (indexBuffer != boundIndexBuffer) {
+                commandBuffer.bindIndexBuffer(*geometry.indexBuffer.getBuffer(), 0, format.indexType);
+                boundIndexBuffer = indexBuffer;
+            }
 
             commandBuffer.pushConstants<PushConstants>(
                 *pipelineLayout_, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0,
                 {
                     PushConstants{
-                                  renderObject.transform, renderInfo.sceneDataBuffer.getAddress(),
-                                  renderObject.vertexBuffer->getAddress(), renderObject.materialId
+                                  renderObject.transform, renderInfo.sceneDataAddress,
+                                  geometry.vertexBuffer.getAddress(), renderObject.materialId,
+                                  static_cast<uint32_t>(format.vertexFormat), format.positionMin,
+                                  format.positionExtent
                     }
             }
             );
 
-            commandBuffer.drawIndexed(static_cast<uint32_t>(renderObject.indexCount), 1, renderObject.firstIndex, 0, 0);
+            commandBuffer.drawIndexed(
+                renderObject.indexCount, 1, renderObject.firstIndex, renderObject.vertexOffset, 0
+            );
         }
 
         commandBuffer.endRendering();
@@ -9,6 +9,7 @@ namespace yuubi {
 
     class Device;
     class DrawContext;
+    class GeometryPool;
     class Image;
     class Buffer;
 
@@ -25,9 +26,10 @@ namespace yuubi {
         struct RenderInfo {
             const vk::raii::CommandBuffer& commandBuffer;
             const DrawContext& context;
+            const GeometryPool& geometryPool;
             vk::Extent2D viewportExtent;
             std::span<vk::DescriptorSet> descriptorSets;
-            const Buffer& sceneDataBuffer;
+            vk::DeviceAddress sceneDataAddress;
             RenderAttachment color;
             RenderAttachment normal;
             RenderAttachment depth;
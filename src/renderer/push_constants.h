@@ -11,6 +11,10 @@ namespace yuubi {
         vk::DeviceAddress sceneDataBuffer;
         vk::DeviceAddress vertexBuffer;
         uint32_t materialId;
+        // Decoding of the vertices, see GeometryFormat.
+        uint32_t vertexFormat;
+        glm::vec3 positionMin;
+        glm::vec3 positionExtent;
     };
 
 }
@@ -18,18 +18,21 @@ namespace yuubi {
 
     void MeshNode::draw(const glm::mat4& topMatrix, DrawContext& context) {
         glm::mat4 nodeMatrix = topMatrix * worldTransform;
+        const auto& geometry = mesh_->geometry();
 
         for (auto& surface: mesh_->surfaces()) {
             if (surface.passType == MaterialPass::Opaque) {
                 context.opaqueSurfaces.emplace_back(
-                    surface.count, surface.startIndex, mesh_->vertexBuffer(), mesh_->indexBuffer(),
-                    surface.materialIndex, nodeMatrix
+                    surface.count, geometry.firstIndex + surface.startIndex,
+                    static_cast<int32_t>(geometry.vertexOffset), geometry.block, mesh_->format(),
+                    context.firstMaterial + surface.materialIndex, nodeMatrix
                 );
             }
             if (surface.passType == MaterialPass::Transparent) {
                 context.transparentSurfaces.emplace_back(
-                    surface.count, surface.startIndex, mesh_->vertexBuffer(), mesh_->indexBuffer(),
-                    surface.materialIndex, nodeMatrix
+                    surface.count, geometry.firstIndex + surface.startIndex,
+                    static_cast<int32_t>(geometry.vertexOffset), geometry.block, mesh_->format(),
+                    context.firstMaterial + surface.materialIndex, nodeMatrix
                 );
             }
         }
@@ -1,16 +1,19 @@
 #pragma once
 
+#include "renderer/vertex.h"
 #include "pch.h"
 #include <glm/glm.hpp>
 
 namespace yuubi {
 
-    class Buffer;
+    // Geometry is referenced by its place in the renderer's GeometryPool:
+    // firstIndex and vertexOffset are relative to the start of the block.
     struct RenderObject {
         uint32_t indexCount;
         uint32_t firstIndex;
-        std::shared_ptr<Buffer> vertexBuffer;
-        std::shared_ptr<Buffer> indexBuffer;
+        int32_t vertexOffset;
+        uint32_t geometryBlock;
+        GeometryFormat geometryFormat;
         uint32_t materialId;
         glm::mat4 transform;
     };
@@ -18,6 +21,9 @@ namespace yuubi {
     struct DrawContext {
         std::vector<RenderObject> opaqueSurfaces;
         std::vector<RenderObject> transparentSurfaces;
+        // Material slot that surfaces' material indices are relative to, set
+        // by the asset being drawn.
+        uint32_t firstMaterial = 0;
     };
 
     class Renderable {
@@ -19,6 +19,7 @@
 #include "renderer/passes/lighting_pass.h"
 #include "renderer/render_object.h"
 #include "renderer/vma/buffer.h"
+#include "renderer/vma/staging_allocator.h"
 #include "renderer/vulkan_usage.h"
 #include "renderer/pipeline_builder.h"
 #include "renderer/descriptor_layout_builder.h"
@@ -29,7 +30,7 @@
 
 namespace yuubi {
 
-    Renderer::Renderer(const Window& window, std::string_view gltfPath) : window_(window) {
+    Renderer::Renderer(const Window& window, std::string_view scenePath) : window_(window) {
         instance_ = Instance{context_};
 
         VkSurfaceKHR tmp;
@@ -42,35 +43,10 @@ namespace yuubi {
         viewport_ = std::make_shared<Viewport>(surface_, device_);
         imguiManager_ = ImguiManager{instance_, *device_, window_, *viewport_};
 
+        geometryPool_ = std::make_unique<GeometryPool>(device_, Viewport::maxFramesInFlight);
         materialManager_ = MaterialManager(device_);
 
-        {
-            constexpr vk::DeviceSize bufferSize = sizeof(SceneData);
-            constexpr vk::BufferCreateInfo bufferCreateInfo{
-                .size = bufferSize,
-                .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst |
-                         vk::BufferUsageFlagBits::eShaderDeviceAddress
-            };
-
-            constexpr VmaAllocationCreateInfo shaderDataBufferAllocInfo{
-                .usage = VMA_MEMORY_USAGE_GPU_ONLY,
-            };
-
-            sceneDataBuffer_ = device_->createBuffer(bufferCreateInfo, shaderDataBufferAllocInfo);
-
-            const SceneData data{
-                .view = {},
-                .proj = {},
-                .viewproj = {},
-                .cameraPosition = {},
-                .ambientColor = {},
-                .sunlightDirection = {},
-                .sunlightColor = {},
-                .materials = materialManager_.getBufferAddress(),
-            };
-
-            sceneDataBuffer_.upload(*device_, &data, sizeof(data), 0);
-        }
+        sceneDataBuffer_ = DynamicBuffer(*device_, sizeof(SceneData));
 
         initCubemapPassResources();
         initIrradianceMapPassResources();
@@ -80,16 +56,17 @@ namespace yuubi {
         initCompositePassResources();
         initTextureManager();
 
-        // asset_ = GLTFAsset(*device_, textureManager_, materialManager_,
+        // asset_ = GLTFAsset::loadAsync(*device_, *textureManager_, materialManager_,
         // "assets/DamagedHelmet/glTF/DamagedHelmet.gltf");
 
         /*
-        asset_ = GLTFAsset(
-                *device_, textureManager_, materialManager_, "assets/ABeautifulGame/glTF/ABeautifulGame.gltf"
+        asset_ = GLTFAsset::loadAsync(
+                *device_, *textureManager_, materialManager_, "assets/ABeautifulGame/glTF/ABeautifulGame.gltf"
         );
         */
 
-        asset_ = GLTFAsset(*device_, textureManager_, materialManager_, gltfPath);
+        // Loads in the background. The scene fills in over the first frames.
+        scene_ = Scene::load(*device_, *geometryPool_, *textureManager_, materialManager_, scenePath);
 
         {
             std::vector setLayouts{*iblDescriptorSetLayout_, *textureDescriptorSetLayout_};
@@ -131,12 +108,17 @@ namespace yuubi {
         generateBRDFLUT();
     }
 
-    Renderer::~Renderer() { device_->getDevice().waitIdle(); }
+    Renderer::~Renderer() {
+        // Stop loading before waiting, since the loader submits uploads.
+        scene_.reset();
+        device_->waitIdle();
+    }
 
-    void Renderer::updateScene(const Camera& camera) {
+    void Renderer::updateScene(const Camera& camera, uint32_t frameIndex) {
         drawContext_.opaqueSurfaces.clear();
+        drawContext_.transparentSurfaces.clear();
 
-        asset_.draw(glm::mat4(1.0f), drawContext_);
+        scene_->draw(glm::mat4(1.0f), drawContext_);
 
         const SceneData data{
             .view = camera.getViewMatrix(),
@@ -147,14 +129,15 @@ namespace yuubi {
             .sunlightDirection = glm::vec4(0, 1, 0.f, 1.0f),
             .sunlightColor = glm::vec4(1.0f),
             .materials = materialManager_.getBufferAddress(),
+            .textureFeedback = textureManager_->feedbackAddress(frameIndex),
+            .textureSlots = textureManager_->slotsAddress(frameIndex),
         };
-        sceneDataBuffer_.upload(*device_, &data, sizeof(data), 0);
+        sceneDataBuffer_.write(frameIndex, data);
     }
 
     void Renderer::draw(const Camera& camera, AppState state) {
         // TODO: move this fetch outside of render loop.
         const auto timestampPeriod = device_->getPhysicalDevice().getProperties2().properties.limits.timestampPeriod;
-        updateScene(camera);
 
         // TODO: move to ImguiManager somehow
         ImGui_ImplVulkan_NewFrame();
@@ -174,6 +157,75 @@ namespace yuubi {
             ImGui::Text("GPU: %f ms", static_cast<float>(gpuTimestamp) * timestampPeriod / 1000000.0f);
             ImGui::End();
 
+            ImGui::Begin("Job System");
+            {
+                const auto now = std::chrono::steady_clock::now();
+                const auto elapsed = std::chrono::duration<float>(now - lastJobStatsTime_).count();
+                const auto jobStats = JobSystem::get().stats();
+                lastJobStats_.resize(jobStats.size());
+
+                for (const auto& [i, stats, lastStats]: std::views::zip(
+                         std::views::iota(0uz, jobStats.size()), jobStats, lastJobStats_
+                     )) {
+                    const auto busy = std::chrono::duration<float>(stats.busyTime - lastStats.busyTime).count();
+                    ImGui::Text(
+                        "Worker %zu: %5.1f%% busy, %llu jobs, %llu stolen", i,
+                        elapsed > 0.0f ? busy / elapsed * 100.0f : 0.0f,
+                        static_cast<unsigned long long>(stats.jobsExecuted),
+                        static_cast<unsigned long long>(stats.jobsStolen)
+                    );
+                }
+
+                lastJobStats_ = jobStats;
+                lastJobStatsTime_ = now;
+            }
+            ImGui::End();
+
+            ImGui::Begin("Scene");
+            {
+                const auto sceneStats = scene_->stats();
+                ImGui::Text("Assets: %zu of %zu loaded", sceneStats.loadedAssets, sceneStats.assets);
+                ImGui::Text("Instances: %zu", sceneStats.instances);
+            }
+            ImGui::End();
+
+            ImGui::Begin("Texture Cache");
+            {
+                const auto cacheStats = textureManager_->cacheStats();
+                const auto lookups = cacheStats.hits + cacheStats.misses;
+                ImGui::Text(
+                    "Hits: %llu of %llu lookups (%.1f%%)", static_cast<unsigned long long>(cacheStats.hits),
+                    static_cast<unsigned long long>(lookups),
+                    lookups > 0 ? static_cast<double>(cacheStats.hits) / static_cast<double>(lookups) * 100.0 : 0.0
+                );
+                ImGui::Text("Textures: %zu", cacheStats.cachedTextures);
+            }
+            ImGui::End();
+
+            ImGui::Begin("Texture Streaming");
+            {
+                const auto streamingStats = textureManager_->streamingStats();
+                constexpr double mebibyte = 1024.0 * 1024.0;
+                ImGui::Text(
+                    "Resident: %.1f of %.1f MiB", static_cast<double>(streamingStats.residentBytes) / mebibyte,
+                    static_cast<double>(streamingStats.budget) / mebibyte
+                );
+                ImGui::Text(
+                    "Images: %zu (%zu requests in flight)", streamingStats.streamedImages,
+                    streamingStats.requestsInFlight
+                );
+                ImGui::Text("Evictions: %llu", static_cast<unsigned long long>(streamingStats.evictions));
+                ImGui::Text(
+                    "Device: %.1f of %.1f MiB", static_cast<double>(streamingStats.device.usage) / mebibyte,
+                    static_cast<double>(streamingStats.device.budget) / mebibyte
+                );
+                ImGui::Text(
+                    "Not streamed: %.1f MiB%s", static_cast<double>(streamingStats.otherBytes) / mebibyte,
+                    streamingStats.overBudget ? " (over budget)" : ""
+                );
+            }
+            ImGui::End();
+
             ImGui::Render();
         };
 
@@ -184,6 +236,22 @@ namespace yuubi {
                            ) {
             vk::CommandBufferBeginInfo beginInfo{};
             frame.commandBuffer.begin(beginInfo);
+
+            // The oldest frame in flight has completed, so geometry it drew
+            // can be reused.
+            geometryPool_->nextFrame();
+            materialManager_.nextFrame();
+
+            // Pick up anything the asset loaders have finished since last frame.
+            scene_->update(frame.commandBuffer);
+
+            // The frame's fence has been waited on, so its scene data slot is
+            // no longer read by the GPU.
+            const uint32_t frameIndex = viewport_->currentFrameIndex();
+            textureManager_->beginFrame(frameIndex);
+            updateScene(camera, frameIndex);
+            const auto sceneDataAddress = sceneDataBuffer_.getAddress(frameIndex);
+
             frame.commandBuffer.resetQueryPool(frame.timestampQueryPool, 0, 2);
             if (frame.timestamps[1] != 0) {
                 frame.commandBuffer.writeTimestamp2(
@@ -197,7 +265,7 @@ namespace yuubi {
             std::vector<vk::DescriptorSet> descriptorSets{*iblDescriptorSet_, *textureDescriptorSet_};
 
             // Depth pre-pass
-            depthPass_.render(frame.commandBuffer, drawContext_, sceneDataBuffer_, descriptorSets);
+            depthPass_.render(frame.commandBuffer, drawContext_, *geometryPool_, sceneDataAddress, descriptorSets);
 
             // Transition draw image.
             {
@@ -253,9 +321,10 @@ namespace yuubi {
                 LightingPass::RenderInfo{
                     .commandBuffer = frame.commandBuffer,
                     .context = drawContext_,
+                    .geometryPool = *geometryPool_,
                     .viewportExtent = viewport_->getExtent(),
                     .descriptorSets = descriptorSets,
-                    .sceneDataBuffer = sceneDataBuffer_,
+                    .sceneDataAddress = sceneDataAddress,
                     .color = RenderAttachment{.image = drawImage.getImage(),.imageView = drawImageView                                                                                             },
                     .normal =
                         RenderAttachment{
@@ -266,6 +335,18 @@ namespace yuubi {
             }
             );
 
+            // Make the texture feedback the lighting pass wrote visible to
+            // the host, which reads it back once the frame's fence signals.
+            {
+                const vk::MemoryBarrier2 feedbackBarrier{
+                    .srcStageMask = vk::PipelineStageFlagBits2::eFragmentShader,
+                    .srcAccessMask = vk::AccessFlagBits2::eShaderStorageWrite,
+                    .dstStageMask = vk::PipelineStageFlagBits2::eHost,
+                    .dstAccessMask = vk::AccessFlagBits2::eHostRead,
+                };
+                frame.commandBuffer.pipelineBarrier2({.memoryBarrierCount = 1, .pMemoryBarriers = &feedbackBarrier});
+            }
+
             // Skybox pass.
             {
                 std::vector descriptorSets{*skyboxDescriptorSet_};
@@ -437,22 +518,37 @@ namespace yuubi {
 
             frame.commandBuffer.end();
 
-            vk::Semaphore waitSemaphores[]{*frame.imageAvailable};
-            vk::PipelineStageFlags waitStages[]{vk::PipelineStageFlagBits::eColorAttachmentOutput};
-
-            vk::Semaphore signalSemaphores[]{*frame.renderFinished};
-
-            vk::SubmitInfo submitInfo{
-                .waitSemaphoreCount = 1,
-                .pWaitSemaphores = waitSemaphores,
-                .pWaitDstStageMask = waitStages,
-                .commandBufferCount = 1,
-                .pCommandBuffers = &*frame.commandBuffer,
-                .signalSemaphoreCount = 1,
-                .pSignalSemaphores = signalSemaphores
+            // Resources are only drawn once their uploads have completed, so
+            // waiting on the current timeline value never stalls the GPU. It
+            // makes the uploaded data visible to this frame.
+            const std::array waitSemaphoreInfos{
+                vk::SemaphoreSubmitInfo{
+                                        .semaphore = *frame.imageAvailable,
+                                        .stageMask = vk::PipelineStageFlagBits2::eColorAttachmentOutput
+                },
+                vk::SemaphoreSubmitInfo{
+                                        .semaphore = *device_->getUploadTimeline(),
+                                        .value = device_->getUploadTimeline().getCounterValue(),
+                                        .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+                }
             };
-
-            device_->getQueue().queue.submit({submitInfo}, *frame.inFlight);
+            const vk::SemaphoreSubmitInfo signalSemaphoreInfo{
+                .semaphore = *frame.renderFinished, .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+            };
+            const vk::CommandBufferSubmitInfo commandBufferSubmitInfo{.commandBuffer = *frame.commandBuffer};
+
+            device_->submit(
+                device_->getQueue(),
+                vk::SubmitInfo2{
+                    .waitSemaphoreInfoCount = waitSemaphoreInfos.size(),
+                    .pWaitSemaphoreInfos = waitSemaphoreInfos.data(),
+                    .commandBufferInfoCount = 1,
+                    .pCommandBufferInfos = &commandBufferSubmitInfo,
+                    .signalSemaphoreInfoCount = 1,
+                    .pSignalSemaphoreInfos = &signalSemaphoreInfo
+                },
+                *frame.inFlight
+            );
 
             auto [result, timestamps] = frame.timestampQueryPool.getResults<uint64_t>(
                 0, 2, sizeof(uint64_t) * 4, sizeof(uint64_t) * 2,
@@ -567,7 +663,7 @@ namespace yuubi {
         aoNoiseImage_ = createImageFromData(*device_, imageData);
         aoNoiseImageView_ = device_->createImageView(
             *aoNoiseImage_.getImage(), vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor,
-            aoNoiseImage_.getMipLevels()
+            aoNoiseImage_.getMipLevels(), vk::ImageViewType::e2D, vk::ImageUsageFlagBits::eSampled
         );
         aoNoiseSampler_ = device_->getDevice().createSampler(
             vk::SamplerCreateInfo{
@@ -718,19 +814,8 @@ namespace yuubi {
 
 
         const vk::DeviceSize imageSize = width * height * 4 * 4;
-        const vk::BufferCreateInfo stagingBufferCreateInfo{
-            .size = imageSize, .usage = vk::BufferUsageFlagBits::eTransferSrc
-        };
-
-        VmaAllocationCreateInfo stagingBufferAllocCreateInfo{
-            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
-            .usage = VMA_MEMORY_USAGE_AUTO,
-        };
-
-        const Buffer stagingBuffer = device_->createBuffer(stagingBufferCreateInfo, stagingBufferAllocCreateInfo);
-
-        auto pixels = std::span{data, static_cast<size_t>(width * height * 4)};
-        std::ranges::copy(pixels, static_cast<float*>(stagingBuffer.getMappedMemory()));
+        auto stagingBlock = device_->stagingAllocator().acquire(imageSize);
+        stagingBlock->buffer.write(data, imageSize, 0);
         stbi_image_free(data);
 
         // Create equirectangular map image.
@@ -749,7 +834,7 @@ namespace yuubi {
         );
 
         // Upload data to image.
-        device_->submitImmediateCommands([this, &stagingBuffer, width,
+        device_->submitImmediateCommands([this, &stagingBlock, width,
                                           height](const vk::raii::CommandBuffer& commandBuffer) {
             transitionImage(
                 commandBuffer, *equirectangularMapImage_.getImage(), vk::ImageLayout::eUndefined,
@@ -772,10 +857,11 @@ namespace yuubi {
                 }
             };
             commandBuffer.copyBufferToImage(
-                *stagingBuffer.getBuffer(), *equirectangularMapImage_.getImage(), vk::ImageLayout::eGeneral,
+                *stagingBlock->buffer.getBuffer(), *equirectangularMapImage_.getImage(), vk::ImageLayout::eGeneral,
                 {copyRegion}
             );
         });
+        device_->stagingAllocator().release(std::move(stagingBlock));
 
         equirectangularMapImageView_ = device_->getDevice().createImageView(
             vk::ImageViewCreateInfo{
@@ -1510,6 +1596,8 @@ namespace yuubi {
     }
 
     void Renderer::initTextureManager() {
+        const uint32_t textureDescriptors = descriptorsPerTexture * TextureManager::deviceCapacity(*device_);
+
         // Create layout.
         DescriptorLayoutBuilder layoutBuilder(device_);
 
@@ -1523,7 +1611,7 @@ namespace yuubi {
                     vk::DescriptorSetLayoutBinding{
                         .binding = 0,
                         .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-                        .descriptorCount = maxTextures,
+                        .descriptorCount = textureDescriptors,
                         .stageFlags = vk::ShaderStageFlagBits::eFragment,
                     }
                 )
@@ -1568,18 +1656,21 @@ namespace yuubi {
 
         // Create pool.
         // TODO: account for other first descriptor set properly
+        constexpr uint32_t maxDescriptors = 1024;
         std::vector poolSizes{
-            vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageImage,     .descriptorCount = maxTextures                                   },
-            vk::DescriptorPoolSize{       .type = vk::DescriptorType::eUniformBuffer,     .descriptorCount = maxTextures},
-            vk::DescriptorPoolSize{             .type = vk::DescriptorType::eSampler,     .descriptorCount = maxTextures},
+            vk::DescriptorPoolSize{.type = vk::DescriptorType::eStorageImage,     .descriptorCount = maxDescriptors                                   },
+            vk::DescriptorPoolSize{       .type = vk::DescriptorType::eUniformBuffer,     .descriptorCount = maxDescriptors},
+            vk::DescriptorPoolSize{             .type = vk::DescriptorType::eSampler,     .descriptorCount = maxDescriptors},
             vk::DescriptorPoolSize{
-                                   .type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = maxTextures + 3}
+                                   .type = vk::DescriptorType::eCombinedImageSampler,
+                                   .descriptorCount = textureDescriptors + 3
+            }
         };
 
         const vk::DescriptorPoolCreateInfo poolInfo{
             .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind |
                      vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-            .maxSets = maxTextures,
+            .maxSets = maxDescriptors,
             .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
             .pPoolSizes = poolSizes.data()
         };
@@ -1594,13 +1685,13 @@ namespace yuubi {
                                           .pSetLayouts = &*textureDescriptorSetLayout_
             },
             vk::DescriptorSetVariableDescriptorCountAllocateInfo{
-                                          .descriptorSetCount = 1, .pDescriptorCounts = &maxTextures
+                                          .descriptorSetCount = 1, .pDescriptorCounts = &textureDescriptors
             }
         };
 
         vk::raii::DescriptorSets sets(device_->getDevice(), allocInfo.get());
         textureDescriptorSet_ = std::make_shared<vk::raii::DescriptorSet>(std::move(sets[0]));
-        textureManager_ = TextureManager(device_, textureDescriptorSet_);
+        textureManager_ = std::make_unique<TextureManager>(device_, textureDescriptorSet_);
 
         {
             vk::raii::DescriptorSets sets(
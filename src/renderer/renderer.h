@@ -1,14 +1,18 @@
 #pragma once
 
+#include "core/job_system.h"
 #include "renderer/camera.h"
 #include "renderer/passes/depth_pass.h"
 #include "renderer/device.h"
+#include "renderer/dynamic_buffer.h"
+#include "renderer/geometry_pool.h"
 #include "renderer/gltf/asset.h"
 #include "renderer/imgui_manager.h"
 #include "renderer/instance.h"
 #include "renderer/passes/lighting_pass.h"
 #include "renderer/render_object.h"
 #include "renderer/resources/material_manager.h"
+#include "renderer/scene.h"
 #include "renderer/viewport.h"
 #include "renderer/vma/buffer.h"
 #include "renderer/resources/texture_manager.h"
@@ -29,7 +33,8 @@ struct AppState;
 namespace yuubi {
     class Renderer {
     public:
-        explicit Renderer(const Window& window, std::string_view gltfPath);
+        // scenePath is a scene file, or a glTF or cooked asset to show alone.
+        explicit Renderer(const Window& window, std::string_view scenePath);
         ~Renderer();
 
         void draw(const Camera& camera, AppState state);
@@ -39,7 +44,7 @@ namespace yuubi {
         void initCompositePassResources();
         void initAOPassResources();
         void initCubemapPassResources();
-        void updateScene(const Camera& camera);
+        void updateScene(const Camera& camera, uint32_t frameIndex);
         void initIrradianceMapPassResources();
         void generateEnvironmentMap() const;
         void generateIrradianceMap() const;
@@ -81,12 +86,15 @@ namespace yuubi {
 
 
         DrawContext drawContext_;
-        GLTFAsset asset_;
+        // Declared before scene_ so meshes can release their geometry.
+        std::unique_ptr<GeometryPool> geometryPool_;
+        std::unique_ptr<Scene> scene_;
         std::unordered_map<std::string, std::shared_ptr<Node>> loadedNodes_;
         std::shared_ptr<Mesh> mesh_;
 
-        // Global scene data updated once per frame/draw call.
-        Buffer sceneDataBuffer_;
+        // Global scene data updated once per frame/draw call. One slot per
+        // frame in flight, written directly by the CPU.
+        DynamicBuffer sceneDataBuffer_;
 
         MaterialManager materialManager_;
 
@@ -99,7 +107,7 @@ namespace yuubi {
         vk::raii::DescriptorSet iblDescriptorSet_ = nullptr;
         std::shared_ptr<vk::raii::DescriptorSet> textureDescriptorSet_;
         LightingPass lightingPass_;
-        TextureManager textureManager_;
+        std::unique_ptr<TextureManager> textureManager_;
 
         // Cubemap.
         CubemapPass cubemapPass_;
@@ -136,6 +144,11 @@ namespace yuubi {
         Image brdfLutMapImage_;
         vk::raii::ImageView brdfLutMapImageView_ = nullptr;
         vk::raii::Sampler brdfLutMapSampler_ = nullptr;
+
+        // Job system statistics at the previous frame, used to show worker
+        // utilization.
+        std::vector<JobSystem::WorkerStats> lastJobStats_;
+        std::chrono::steady_clock::time_point lastJobStatsTime_;
     };
 
 }
@@ -1,29 +1,144 @@
 #include "renderer/resources/material_manager.h"
 #include "renderer/device.h"
+#include "renderer/viewport.h"
 
 namespace yuubi {
 
-    MaterialManager::MaterialManager(std::shared_ptr<Device> device) : device_(std::move(device)) {
-        constexpr vk::DeviceSize bufferSize = maxMaterials * sizeof(MaterialData);
-        vk::BufferCreateInfo bufferCreateInfo{
-            .size = bufferSize,
-            .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst |
-                     vk::BufferUsageFlagBits::eShaderDeviceAddress
-        };
+    namespace {
+        Buffer createMaterialBuffer(Device& device, size_t capacity) {
+            vk::BufferCreateInfo bufferCreateInfo{
+                .size = capacity * sizeof(MaterialData),
+                .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc |
+                         vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eShaderDeviceAddress
+            };
+
+            VmaAllocationCreateInfo shaderDataBufferAllocInfo{
+                .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+            };
+
+            return device.createBuffer(bufferCreateInfo, shaderDataBufferAllocInfo);
+        }
+    }
+
+    MaterialManager::MaterialManager(std::shared_ptr<Device> device) :
+        ResourceManager(initialCapacity, Viewport::maxFramesInFlight), device_(std::move(device)),
+        materialBuffer_(createMaterialBuffer(*device_, initialCapacity)) {}
+
+    std::vector<ResourceHandle> MaterialManager::addResources(
+        std::span<const std::shared_ptr<MaterialData>> materials, const vk::raii::CommandBuffer& commandBuffer
+    ) {
+        reserve(materials.size(), commandBuffer);
+        auto handles = ResourceManager::addResources(materials);
+        updateResources(handles, commandBuffer);
+        return handles;
+    }
+
+    void MaterialManager::updateResources(
+        std::span<const ResourceHandle> handles, const vk::raii::CommandBuffer& commandBuffer
+    ) const {
+        if (handles.empty()) {
+            return;
+        }
+
+        const size_t count = handles.size();
+        std::vector<MaterialData> data;
+        data.reserve(count);
+        for (const auto handle: handles) {
+            assert(resourceIndex(handle) == resourceIndex(handles.front()) + data.size());
+            data.push_back(*get(handle));
+        }
 
-        VmaAllocationCreateInfo shaderDataBufferAllocInfo{
-            .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+        const vk::DeviceSize offset = sizeof(MaterialData) * resourceIndex(handles.front());
+        const vk::DeviceSize size = sizeof(MaterialData) * count;
+
+        // Wait for earlier frames to stop reading before overwriting.
+        const vk::BufferMemoryBarrier2 preWriteBarrier{
+            .srcStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+            .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .buffer = *materialBuffer_.getBuffer(),
+            .offset = offset,
+            .size = size
         };
+        commandBuffer.pipelineBarrier2({.bufferMemoryBarrierCount = 1, .pBufferMemoryBarriers = &preWriteBarrier});
+
+        // vkCmdUpdateBuffer is limited to 64 KiB per call.
+        constexpr size_t maxMaterialsPerUpdate = 65536 / sizeof(MaterialData);
+        for (size_t i = 0; i < count; i += maxMaterialsPerUpdate) {
+            const auto chunk = std::span{data}.subspan(i, std::min(maxMaterialsPerUpdate, count - i));
+            commandBuffer.updateBuffer<MaterialData>(
+                *materialBuffer_.getBuffer(), offset + sizeof(MaterialData) * i, chunk
+            );
+        }
 
-        materialBuffer_ = device_->createBuffer(bufferCreateInfo, shaderDataBufferAllocInfo);
+        const vk::BufferMemoryBarrier2 postWriteBarrier{
+            .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+            .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead,
+            .buffer = *materialBuffer_.getBuffer(),
+            .offset = offset,
+            .size = size
+        };
+        commandBuffer.pipelineBarrier2({.bufferMemoryBarrierCount = 1, .pBufferMemoryBarriers = &postWriteBarrier});
     }
 
-    ResourceHandle MaterialManager::addResource(const std::shared_ptr<MaterialData>& material) {
-        const auto handle = ResourceManager::addResource(material);
+    void MaterialManager::reserve(size_t count, const vk::raii::CommandBuffer& commandBuffer) {
+        if (count == 0 || canAdd(count)) {
+            return;
+        }
+
+        size_t newCapacity = capacity();
+        while (newCapacity < usedSlots() + count) {
+            newCapacity *= 2;
+        }
+        newCapacity = std::min(newCapacity, maxResourceCapacity);
+        if (newCapacity == capacity()) {
+            // Full; adding throws.
+            return;
+        }
+
+        auto buffer = createMaterialBuffer(*device_, newCapacity);
+        const vk::DeviceSize size = sizeof(MaterialData) * usedSlots();
 
-        materialBuffer_.upload(*device_, material.get(), sizeof(MaterialData), sizeof(MaterialData) * handle);
+        if (size > 0) {
+            // Earlier writes to the old buffer must land before it is copied.
+            const vk::BufferMemoryBarrier2 preCopyBarrier{
+                .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+                .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+                .dstAccessMask = vk::AccessFlagBits2::eTransferRead,
+                .buffer = *materialBuffer_.getBuffer(),
+                .offset = 0,
+                .size = size
+            };
+            commandBuffer.pipelineBarrier2({.bufferMemoryBarrierCount = 1, .pBufferMemoryBarriers = &preCopyBarrier});
+
+            commandBuffer.copyBuffer(*materialBuffer_.getBuffer(), *buffer.getBuffer(), vk::BufferCopy{.size = size});
+
+            const vk::BufferMemoryBarrier2 postCopyBarrier{
+                .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+                .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+                .dstAccessMask = vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eTransferWrite,
+                .buffer = *buffer.getBuffer(),
+                .offset = 0,
+                .size = size
+            };
+            commandBuffer.pipelineBarrier2({.bufferMemoryBarrierCount = 1, .pBufferMemoryBarriers = &postCopyBarrier});
+        }
+
+        // Frames in flight keep reading the old buffer through its address.
+        retiredBuffers_.emplace_back(frame(), std::exchange(materialBuffer_, std::move(buffer)));
+        grow(newCapacity);
+        UB_INFO("Grew material buffer to {} materials", newCapacity);
+    }
 
-        return handle;
+    void MaterialManager::nextFrame() {
+        ResourceManager::nextFrame();
+        while (!retiredBuffers_.empty() && frame() - retiredBuffers_.front().first >= Viewport::maxFramesInFlight) {
+            retiredBuffers_.pop_front();
+        }
     }
 
 }
@@ -4,37 +4,67 @@
 #include "renderer/vma/buffer.h"
 #include "renderer/gpu_data.h"
 #include "pch.h"
+#include <deque>
 
 namespace yuubi {
 
-    // TODO: Find right limit.
-    constexpr uint32_t maxMaterials = 1024;
-
     class Device;
-    class MaterialManager final : ResourceManager<MaterialData, maxMaterials>, NonCopyable {
+
+    // Table of every material, read by shaders through the address of the
+    // material buffer. The buffer doubles in size when it runs out of room,
+    // so its address changes; it must be read again after adding materials.
+    class MaterialManager final : ResourceManager<MaterialData>, NonCopyable {
     public:
+        static constexpr size_t initialCapacity = 1024;
+
         MaterialManager() = default;
         explicit MaterialManager(std::shared_ptr<Device> device);
         MaterialManager(MaterialManager&& rhs) noexcept :
             ResourceManager(std::move(rhs)), device_(std::exchange(rhs.device_, {})),
-            materialBuffer_(std::exchange(rhs.materialBuffer_, {})) {};
+            materialBuffer_(std::exchange(rhs.materialBuffer_, {})),
+            retiredBuffers_(std::exchange(rhs.retiredBuffers_, {})) {};
         MaterialManager& operator=(MaterialManager&& rhs) noexcept {
             if (this != &rhs) {
                 ResourceManager::operator=(std::move(rhs));
                 std::swap(device_, rhs.device_);
                 std::swap(materialBuffer_, rhs.materialBuffer_);
+                std::swap(retiredBuffers_, rhs.retiredBuffers_);
             }
 
             return *this;
         }
 
-        virtual ResourceHandle addResource(const std::shared_ptr<MaterialData>& material) override;
+        // Adds materials to consecutive slots and returns their handles. The
+        // writes, and the move to a larger buffer if they don't fit, are
+        // recorded into commandBuffer, which orders them with frames that are
+        // still reading the material buffer.
+        std::vector<ResourceHandle> addResources(
+            std::span<const std::shared_ptr<MaterialData>> materials, const vk::raii::CommandBuffer& commandBuffer
+        );
+        // Re-uploads materials that have been modified in place. handles
+        // must be consecutive, as returned by addResources().
+        void updateResources(
+            std::span<const ResourceHandle> handles, const vk::raii::CommandBuffer& commandBuffer
+        ) const;
+
+        // Frees removed materials and outgrown buffers once the frames in
+        // flight that may read them have finished.
+        void nextFrame();
+
+        using ResourceManager::capacity;
+        using ResourceManager::removeResource;
 
         [[nodiscard]] inline vk::DeviceAddress getBufferAddress() const { return materialBuffer_.getAddress(); }
 
     private:
+        // Makes room for count consecutive materials, moving every material
+        // to a larger buffer if there is no free run long enough.
+        void reserve(size_t count, const vk::raii::CommandBuffer& commandBuffer);
+
         std::shared_ptr<Device> device_;
         Buffer materialBuffer_;
+        // Outgrown buffers and the frame they were replaced in.
+        std::deque<std::pair<uint64_t, Buffer>> retiredBuffers_;
     };
 
 }
@@ -1,27 +1,100 @@
 #pragma once
 
+#include "core/range_allocator.h"
 #include "pch.h"
+#include <deque>
 
 namespace yuubi {
 
+    // Handles pack the index of a resource's slot, which is also where
+    // shaders find it, with the generation of the slot. Removing a resource
+    // bumps its slot's generation, so stale handles stop resolving instead of
+    // aliasing whatever reuses the slot.
     using ResourceHandle = uint32_t;
 
-    template<typename ResourceType, size_t Size>
+    constexpr uint32_t resourceIndexBits = 20;
+    constexpr size_t maxResourceCapacity = 1uz << resourceIndexBits;
+
+    [[nodiscard]] constexpr uint32_t resourceIndex(ResourceHandle handle) {
+        return handle & ((1u << resourceIndexBits) - 1);
+    }
+
+    [[nodiscard]] constexpr uint32_t resourceGeneration(ResourceHandle handle) { return handle >> resourceIndexBits; }
+
+    [[nodiscard]] constexpr ResourceHandle makeResourceHandle(uint32_t index, uint32_t generation) {
+        return generation << resourceIndexBits | index;
+    }
+
+    // Slot map of resources. Removed resources are kept in a
+    // deletion queue until the frames in flight that may reference them have
+    // completed, so GPU objects they own outlive those frames and their slot,
+    // a bindless descriptor or buffer element, isn't reused before then.
+    // nextFrame() must be called once per frame, after waiting for the
+    // oldest frame in flight.
+    //
+    // Slots are handed out lowest first, so every slot from usedSlots() on
+    // is free. Derived managers can grow the table, but only from the render
+    // thread, as slots may move.
+    template<typename ResourceType>
     class ResourceManager : NonCopyable {
     public:
         virtual ~ResourceManager() = default;
 
+        // Throws if every slot is in use.
         virtual ResourceHandle addResource(const std::shared_ptr<ResourceType>& resource) {
-            resources_[nextAvailableHandle_] = resource;
-            return nextAvailableHandle_++;
+            return addResources({&resource, 1}).front();
         };
+        // Removes the resource once no frame in flight can reference it. Does
+        // nothing if handle is stale.
+        virtual void removeResource(ResourceHandle handle) {
+            if (!contains(handle)) {
+                return;
+            }
+
+            auto& slot = slots_[resourceIndex(handle)];
+            deletionQueue_.push_back({
+                .resource = std::exchange(slot.resource, nullptr),
+                .index = resourceIndex(handle),
+                .frame = frame_,
+            });
+            slot.generation = (slot.generation + 1) % (1u << (32 - resourceIndexBits));
+        }
+
+        [[nodiscard]] bool contains(ResourceHandle handle) const {
+            const auto index = resourceIndex(handle);
+            return index < slots_.size() && slots_[index].resource != nullptr &&
+                   slots_[index].generation == resourceGeneration(handle);
+        }
+        // Null if handle is stale.
+        [[nodiscard]] const std::shared_ptr<ResourceType>& get(ResourceHandle handle) const {
+            static const std::shared_ptr<ResourceType> stale;
+            return contains(handle) ? slots_[resourceIndex(handle)].resource : stale;
+        }
+
+        [[nodiscard]] size_t capacity() const { return slots_.size(); }
+        // One past the highest slot ever used.
+        [[nodiscard]] size_t usedSlots() const { return usedSlots_; }
+
+        void nextFrame() {
+            frame_++;
+            while (!deletionQueue_.empty() && frame_ - deletionQueue_.front().frame >= framesInFlight_) {
+                freeSlots_.free(deletionQueue_.front().index, 1);
+                deletionQueue_.pop_front();
+            }
+        }
+
         ResourceManager(ResourceManager&& rhs) noexcept :
-            nextAvailableHandle_(std::exchange(rhs.nextAvailableHandle_, 0)),
-            resources_(std::exchange(rhs.resources_, {})) {};
+            slots_(std::exchange(rhs.slots_, {})), freeSlots_(std::exchange(rhs.freeSlots_, {})),
+            usedSlots_(std::exchange(rhs.usedSlots_, 0)), deletionQueue_(std::exchange(rhs.deletionQueue_, {})),
+            framesInFlight_(rhs.framesInFlight_), frame_(rhs.frame_) {};
         ResourceManager& operator=(ResourceManager&& rhs) noexcept {
             if (this != &rhs) {
-                std::swap(nextAvailableHandle_, rhs.nextAvailableHandle_);
-                std::swap(resources_, rhs.resources_);
+                std::swap(slots_, rhs.slots_);
+                std::swap(freeSlots_, rhs.freeSlots_);
+                std::swap(usedSlots_, rhs.usedSlots_);
+                std::swap(deletionQueue_, rhs.deletionQueue_);
+                std::swap(framesInFlight_, rhs.framesInFlight_);
+                std::swap(frame_, rhs.frame_);
             }
 
             return *this;
@@ -29,13 +102,62 @@ namespace yuubi {
 
     protected:
         ResourceManager() = default;
+        ResourceManager(size_t capacity, uint32_t framesInFlight) :
+            slots_(capacity), freeSlots_(capacity), framesInFlight_(framesInFlight) {
+            assert(capacity <= maxResourceCapacity);
+        }
+
+        [[nodiscard]] bool canAdd(size_t count) const { return freeSlots_.largestFreeRange() >= count; }
+        [[nodiscard]] uint64_t frame() const { return frame_; }
 
+        void grow(size_t capacity) {
+            assert(capacity >= slots_.size() && capacity <= maxResourceCapacity);
+            slots_.resize(capacity);
+            freeSlots_.grow(capacity);
+        }
+
+        // Adds resources to consecutive slots and returns their handles.
+        // Throws if there is no free run of slots long enough.
+        std::vector<ResourceHandle> addResources(std::span<const std::shared_ptr<ResourceType>> resources) {
+            if (resources.empty()) {
+                return {};
+            }
+
+            const auto first = freeSlots_.allocate(resources.size());
+            if (!first.has_value()) {
+                throw std::runtime_error{"Resource table is full"};
+            }
+
+            usedSlots_ = std::max(usedSlots_, static_cast<size_t>(*first + resources.size()));
+
+            std::vector<ResourceHandle> handles;
+            handles.reserve(resources.size());
+            for (const auto& [i, resource]: std::views::enumerate(resources)) {
+                const auto index = static_cast<uint32_t>(*first + i);
+                slots_[index].resource = resource;
+                handles.push_back(makeResourceHandle(index, slots_[index].generation));
+            }
+            return handles;
+        }
+
+    private:
+        struct Slot {
+            std::shared_ptr<ResourceType> resource;
+            uint32_t generation = 0;
+        };
+
+        struct PendingDeletion {
+            std::shared_ptr<ResourceType> resource;
+            uint32_t index;
+            uint64_t frame;
+        };
 
-        ResourceHandle nextAvailableHandle_ = 0;
-        // TODO: This implementation keeps the resources in memory until the manager
-        // is destroyed along with all other references. Use a slot map with
-        // weak references instead to allow for resource removal.
-        std::array<std::shared_ptr<ResourceType>, Size> resources_;
+        std::vector<Slot> slots_;
+        RangeAllocator freeSlots_;
+        size_t usedSlots_ = 0;
+        std::deque<PendingDeletion> deletionQueue_;
+        uint32_t framesInFlight_ = 1;
+        uint64_t frame_ = 0;
     };
 
 }
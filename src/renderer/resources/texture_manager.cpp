@@ -1,41 +1,547 @@
 #include "renderer/resources/texture_manager.h"
+#include "core/hash.h"
 #include "renderer/descriptor_layout_builder.h"
 #include "renderer/device.h"
+#include "renderer/sampler_cache.h"
+#include "renderer/viewport.h"
 #include "glm/glm.hpp"
 #include "renderer/vma/image.h"
 
 namespace yuubi {
 
+    namespace {
+        // Written to the feedback buffer before a frame; textures it isn't
+        // sampled in keep it.
+        constexpr uint32_t notSampled = std::numeric_limits<uint32_t>::max();
+        // Added to the levels in the feedback buffer, relative to the first
+        // resident level, so finer ones fit. Matches TEXTURE_FEEDBACK_BIAS in
+        // texture_streaming.glsl.
+        constexpr uint32_t feedbackBias = 16;
+        // Frames an image must go sampled coarser than its resident levels
+        // before they are dropped, so camera jitter doesn't thrash uploads.
+        constexpr uint64_t streamingEvictionFrames = 120;
+        constexpr size_t maxStreamingRequests = 16;
+        // Share of the heap budget left unallocated for allocations made
+        // between budget updates.
+        constexpr vk::DeviceSize budgetHeadroomPercent = 10;
+        // Update-after-bind descriptors left for the sets bound alongside the
+        // texture table.
+        constexpr uint32_t reservedDescriptors = 64;
+    }
+
+    std::shared_ptr<const TextureImage> makeTextureImage(const Device& device, Image&& image) {
+        auto imageView = device.createImageView(
+            *image.getImage(), image.getImageFormat(), vk::ImageAspectFlagBits::eColor, image.getMipLevels(),
+            vk::ImageViewType::e2D, vk::ImageUsageFlagBits::eSampled
+        );
+        return std::make_shared<const TextureImage>(std::move(image), std::move(imageView));
+    }
+
     TextureManager::TextureManager(
         std::shared_ptr<Device> device, std::shared_ptr<vk::raii::DescriptorSet> textureSet
-    ) : device_(std::move(device)), textureSet_(std::move(textureSet)) {
+    ) :
+        ResourceManager(deviceCapacity(*device), Viewport::maxFramesInFlight), device_(std::move(device)),
+        textureSet_(std::move(textureSet)), descriptorSlots_(capacity()) {
+        const vk::BufferCreateInfo feedbackCreateInfo{
+            .size = feedbackBlockSize() * Viewport::maxFramesInFlight,
+            .usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress
+        };
+        // Read back on the host every frame, so prefer cached host memory.
+        const VmaAllocationCreateInfo feedbackAllocInfo{
+            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+        };
+        feedbackBuffer_ = device_->createBuffer(feedbackCreateInfo, feedbackAllocInfo);
+        std::fill_n(
+            static_cast<uint32_t*>(feedbackBuffer_.getMappedMemory()), capacity() * Viewport::maxFramesInFlight,
+            notSampled
+        );
+        feedbackBuffer_.flush(0, vk::WholeSize);
+
+        slotBuffer_ = DynamicBuffer(*device_, capacity() * sizeof(uint32_t));
+        streamer_ = std::make_unique<TextureStreamer>(*device_);
+
         createErrorTexture();
+        flushDescriptorWrites();
+        UB_INFO("Texture table holds {} textures", capacity());
+    }
+
+    uint32_t TextureManager::deviceCapacity(const Device& device) {
+        const auto properties =
+            device.getPhysicalDevice()
+                .getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+        const auto& limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+        const uint32_t descriptors = std::min({
+            limits.maxDescriptorSetUpdateAfterBindSampledImages,
+            limits.maxDescriptorSetUpdateAfterBindSamplers,
+            limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+            limits.maxPerStageUpdateAfterBindResources,
+        });
+
+        const uint32_t textures = (descriptors - std::min(descriptors, reservedDescriptors)) / descriptorsPerTexture;
+        return std::min({textures, maxCapacity, static_cast<uint32_t>(maxResourceCapacity)});
     }
 
     ResourceHandle TextureManager::addResource(const std::shared_ptr<Texture>& texture) {
         const auto handle = ResourceManager::addResource(texture);
+        descriptorSlots_[resourceIndex(handle)] = descriptorsPerTexture * resourceIndex(handle);
+        writeDescriptor(handle);
+        return handle;
+    }
 
-        const vk::DescriptorImageInfo imageInfo{
-            .sampler = *texture->sampler,
-            .imageView = *texture->imageView,
-            .imageLayout = vk::ImageLayout::eGeneral
+    void TextureManager::writeDescriptor(ResourceHandle handle) {
+        const auto& texture = *get(handle);
+        descriptorWrites_.emplace_back(
+            descriptorSlots_[resourceIndex(handle)],
+            vk::DescriptorImageInfo{
+                .sampler = texture.sampler,
+                .imageView = *texture.image->imageView,
+                .imageLayout = vk::ImageLayout::eGeneral
+            }
+        );
+    }
+
+    void TextureManager::flushDescriptorWrites() {
+        if (descriptorWrites_.empty()) {
+            return;
+        }
+
+        // The last write to each descriptor wins, and runs of consecutive
+        // descriptors share a write.
+        const auto element = [](const auto& write) { return write.first; };
+        std::ranges::reverse(descriptorWrites_);
+        std::ranges::stable_sort(descriptorWrites_, {}, element);
+        descriptorWrites_.erase(
+            std::ranges::unique(descriptorWrites_, {}, element).begin(), descriptorWrites_.end()
+        );
+
+        const auto imageInfos = descriptorWrites_ | std::views::values | std::ranges::to<std::vector>();
+        std::vector<vk::WriteDescriptorSet> writes;
+        for (size_t i = 0; i < descriptorWrites_.size();) {
+            uint32_t count = 1;
+            while (i + count < descriptorWrites_.size() &&
+                   descriptorWrites_[i + count].first == descriptorWrites_[i].first + count) {
+                count++;
+            }
+            writes.push_back({
+                .dstSet = *textureSet_,
+                .dstBinding = 0,
+                .dstArrayElement = descriptorWrites_[i].first,
+                .descriptorCount = count,
+                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                .pImageInfo = &imageInfos[i],
+            });
+            i += count;
+        }
+
+        device_->getDevice().updateDescriptorSets(writes, {});
+        descriptorWrites_.clear();
+    }
+
+    std::optional<ResourceHandle> TextureManager::acquireCached(const TextureKey& key) {
+        std::lock_guard lock(cacheMutex_);
+        const auto it = cache_.find(key);
+        if (it == cache_.end()) {
+            stats_.misses++;
+            return std::nullopt;
+        }
+
+        stats_.hits++;
+        it->second.references++;
+        return it->second.handle;
+    }
+
+    std::shared_ptr<const TextureImage> TextureManager::findCachedImage(
+        uint64_t contentHash, TextureRole role
+    ) const {
+        std::lock_guard lock(cacheMutex_);
+        const auto it = images_.find({contentHash, role});
+        return it != images_.end() ? get(it->second)->image : nullptr;
+    }
+
+    std::optional<ResourceHandle> TextureManager::addCached(
+        const TextureKey& key, const std::shared_ptr<Texture>& texture
+    ) {
+        {
+            std::lock_guard lock(cacheMutex_);
+            if (const auto it = cache_.find(key); it != cache_.end()) {
+                it->second.references++;
+                return it->second.handle;
+            }
+        }
+
+        if (!canAdd(1)) {
+            UB_ERROR("Texture table is full ({} textures)", capacity());
+            return std::nullopt;
+        }
+
+        // Only the render thread adds textures, so nothing can cache key in
+        // the meantime.
+        const auto handle = addResource(texture);
+        shareStream(handle);
+        std::lock_guard lock(cacheMutex_);
+        cache_.emplace(key, CacheEntry{.handle = handle, .references = 1});
+        images_.try_emplace({key.contentHash, key.role}, handle);
+        return handle;
+    }
+
+    void TextureManager::release(ResourceHandle handle) {
+        {
+            std::lock_guard lock(cacheMutex_);
+            const auto it = std::ranges::find_if(cache_, [handle](const auto& entry) {
+                return entry.second.handle == handle;
+            });
+            if (it == cache_.end() || --it->second.references > 0) {
+                return;
+            }
+
+            // Textures with the same content and another sampler keep
+            // sharing the image.
+            const std::pair imageKey{it->first.contentHash, it->first.role};
+            cache_.erase(it);
+            if (images_.at(imageKey) == handle) {
+                const auto other = std::ranges::find_if(cache_, [&imageKey](const auto& entry) {
+                    return std::pair{entry.first.contentHash, entry.first.role} == imageKey;
+                });
+                if (other != cache_.end()) {
+                    images_[imageKey] = other->second.handle;
+                } else {
+                    images_.erase(imageKey);
+                }
+            }
+            removeResource(handle);
+        }
+
+        // Stale slot table entries sample the error texture.
+        descriptorSlots_[resourceIndex(handle)] = 0;
+        unstream(handle);
+    }
+
+    TextureCacheStats TextureManager::cacheStats() const {
+        std::lock_guard lock(cacheMutex_);
+        auto stats = stats_;
+        stats.cachedTextures = cache_.size();
+        return stats;
+    }
+
+    uint32_t TextureManager::streamingTailMip(uint32_t width, uint32_t height, uint32_t mipLevels) {
+        uint32_t mip = 0;
+        while (mip + 1 < mipLevels && std::max(width >> mip, height >> mip) > streamingTailSize) {
+            mip++;
+        }
+        return mip;
+    }
+
+    void TextureManager::stream(ResourceHandle handle, StreamingSource source, uint32_t firstMip) {
+        if (shareStream(handle)) {
+            return;
+        }
+
+        StreamedImage image{
+            .source = std::move(source),
+            .image = get(handle)->image,
+            .handles = {handle},
+            .firstMip = firstMip,
+            .tailMip = firstMip,
+            .wantedMip = firstMip,
         };
+        residentBytes_ += residentBytes(image, image.firstMip);
+
+        // Streamer requests refer to images by index, so the entries of
+        // removed images are reused once nothing is in flight for them.
+        const auto unused = std::ranges::find_if(streamedImages_, [](const StreamedImage& streamed) {
+            return streamed.image == nullptr && !streamed.requestedMip.has_value();
+        });
+        if (unused != streamedImages_.end()) {
+            *unused = std::move(image);
+        } else {
+            streamedImages_.push_back(std::move(image));
+        }
+    }
+
+    void TextureManager::unstream(ResourceHandle handle) {
+        const auto it = std::ranges::find_if(streamedImages_, [handle](const StreamedImage& image) {
+            return std::ranges::contains(image.handles, handle);
+        });
+        if (it == streamedImages_.end()) {
+            return;
+        }
+
+        std::erase(it->handles, handle);
+        if (it->handles.empty()) {
+            residentBytes_ -= residentBytes(*it, it->firstMip);
+            retiredImages_.emplace_back(frameNumber_, std::exchange(it->image, nullptr));
+            if (it->pending.has_value()) {
+                it->pending.reset();
+                it->requestedMip.reset();
+            }
+        }
+    }
+
+    bool TextureManager::shareStream(ResourceHandle handle) {
+        const auto& image = get(handle)->image;
+        const auto it = std::ranges::find(streamedImages_, image, &StreamedImage::image);
+        if (it == streamedImages_.end()) {
+            return false;
+        }
+        if (!std::ranges::contains(it->handles, handle)) {
+            it->handles.push_back(handle);
+        }
+        return true;
+    }
 
-        device_->getDevice().updateDescriptorSets(
+    void TextureManager::beginFrame(uint32_t frameIndex) {
+        frameNumber_++;
+        nextFrame();
+        updateStreamingBudget();
+        readFeedback(frameIndex);
+        swapStreamedImages();
+        requestStreaming();
+        flushDescriptorWrites();
+
+        while (!retiredImages_.empty() &&
+               frameNumber_ - retiredImages_.front().first >= Viewport::maxFramesInFlight) {
+            retiredImages_.pop_front();
+        }
+
+        slotBuffer_.write(frameIndex, descriptorSlots_.data(), usedSlots() * sizeof(uint32_t));
+    }
+
+    void TextureManager::updateStreamingBudget() {
+        const auto& allocator = device_->allocator();
+        allocator.setFrameIndex(static_cast<uint32_t>(frameNumber_));
+        deviceBudget_ = allocator.deviceLocalBudget();
+
+        // Streamed images get what the rest of the process leaves of the
+        // heap budget.
+        const auto usableBytes = deviceBudget_.budget / 100 * (100 - budgetHeadroomPercent);
+        otherBytes_ = deviceBudget_.usage - std::min(deviceBudget_.usage, residentBytes_);
+        streamingBudget_ = std::min(maxStreamingBudget_, usableBytes - std::min(usableBytes, otherBytes_));
+    }
+
+    void TextureManager::readFeedback(uint32_t frameIndex) {
+        // Slots past usedSlots() have never been sampled.
+        const vk::DeviceSize offset = feedbackBlockSize() * frameIndex;
+        const vk::DeviceSize size = usedSlots() * sizeof(uint32_t);
+        feedbackBuffer_.invalidate(offset, size);
+        const auto sampledMips = std::span(
+            reinterpret_cast<uint32_t*>(static_cast<std::byte*>(feedbackBuffer_.getMappedMemory()) + offset),
+            usedSlots()
+        );
+
+        for (auto& image: streamedImages_) {
+            if (image.image == nullptr) {
+                continue;
+            }
+            if (std::ranges::any_of(image.handles, [&](ResourceHandle handle) {
+                    return sampledMips[resourceIndex(handle)] != notSampled;
+                })) {
+                image.lastSampledFrame = frameNumber_;
+            }
+
+            // Levels are recorded relative to the image the frame sampled,
+            // which may have been replaced since.
+            if (frameNumber_ - image.swapFrame <= Viewport::maxFramesInFlight) {
+                continue;
+            }
+
+            uint32_t sampledMip = image.tailMip;
+            for (const auto handle: image.handles) {
+                const auto sampled = sampledMips[resourceIndex(handle)];
+                if (sampled != notSampled) {
+                    const auto mip = image.firstMip + sampled;
+                    sampledMip = std::min(sampledMip, mip > feedbackBias ? mip - feedbackBias : 0);
+                }
+            }
+
+            if (sampledMip <= image.wantedMip || frameNumber_ - image.wantedFrame >= streamingEvictionFrames) {
+                image.wantedMip = sampledMip;
+                image.wantedFrame = frameNumber_;
+            }
+        }
+
+        std::ranges::fill(sampledMips, notSampled);
+        feedbackBuffer_.flush(offset, size);
+    }
+
+    void TextureManager::swapStreamedImages() {
+        for (auto& result: streamer_->takeCompleted()) {
+            auto& image = streamedImages_[result.id];
+            if (image.image == nullptr) {
+                // Removed while the request was in flight.
+                image.requestedMip.reset();
+                continue;
+            }
+            image.pending = std::move(result);
+        }
+
+        for (auto& image: streamedImages_) {
+            // The other descriptors were last used by the frame before the
+            // previous swap, which must have finished before they change.
+            if (!image.pending.has_value() || frameNumber_ - image.swapFrame < Viewport::maxFramesInFlight) {
+                continue;
+            }
+
+            auto result = std::move(*image.pending);
+            image.pending.reset();
+            image.requestedMip.reset();
+            if (result.outOfMemory) {
+                // Keeps its levels, and tries again once the budget has had
+                // time to settle.
+                image.retryFrame = frameNumber_ + streamingEvictionFrames;
+                continue;
+            }
+            if (result.image == nullptr) {
+                image.failed = true;
+                continue;
+            }
+
+            residentBytes_ += residentBytes(image, result.firstMip);
+            residentBytes_ -= residentBytes(image, image.firstMip);
             {
-                vk::WriteDescriptorSet{
-                                       .dstSet = *textureSet_,
-                                       .dstBinding = 0,
-                                       .dstArrayElement = handle,
-                                       .descriptorCount = 1,
-                                       .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-                                       .pImageInfo = &imageInfo
+                // Loader threads share images of cached textures.
+                std::lock_guard lock(cacheMutex_);
+                for (const auto handle: image.handles) {
+                    get(handle)->image = result.image;
+                }
+            }
+            for (const auto handle: image.handles) {
+                descriptorSlots_[resourceIndex(handle)] ^= 1;
+                writeDescriptor(handle);
+            }
+
+            retiredImages_.emplace_back(frameNumber_, std::exchange(image.image, std::move(result.image)));
+            image.firstMip = result.firstMip;
+            image.swapFrame = frameNumber_;
+        }
+    }
+
+    void TextureManager::requestStreaming() {
+        // Bytes resident once every request in flight has been swapped in,
+        // and with every image down to its mip tail.
+        vk::DeviceSize projectedBytes = 0;
+        vk::DeviceSize tailBytes = 0;
+        size_t inFlight = 0;
+        for (const auto& image: streamedImages_) {
+            if (image.image != nullptr) {
+                projectedBytes += residentBytes(image, image.requestedMip.value_or(image.firstMip));
+                tailBytes += residentBytes(image, image.tailMip);
+            }
+            inFlight += image.requestedMip.has_value() ? 1 : 0;
+        }
+
+        // Mip tails, meshes and unstreamed textures are never evicted, so
+        // if they don't fit, the budget can't be met.
+        const bool overBudget = tailBytes > streamingBudget_;
+        if (overBudget != overBudget_) {
+            constexpr vk::DeviceSize mebibyte = 1024 * 1024;
+            if (overBudget) {
+                UB_ERROR(
+                    "Device memory budget of {} MiB can't be met: {} MiB are used outside texture streaming",
+                    deviceBudget_.budget / mebibyte, otherBytes_ / mebibyte
+                );
+            } else {
+                UB_INFO("Device memory budget can be met again");
+            }
+            overBudget_ = overBudget;
+        }
+
+        const auto request = [&](size_t id, uint32_t firstMip) {
+            auto& image = streamedImages_[id];
+            projectedBytes = projectedBytes + residentBytes(image, firstMip) - residentBytes(image, image.firstMip);
+            image.requestedMip = firstMip;
+            streamer_->request({
+                .id = static_cast<uint32_t>(id),
+                .path = image.source.path,
+                .firstMip = firstMip,
+                .withinBudget = firstMip < image.firstMip,
+            });
+        };
+        const auto idle = [](const StreamedImage& image) {
+            return image.image != nullptr && !image.requestedMip.has_value() && !image.failed;
+        };
+
+        // Levels that have gone unsampled are dropped first, making room.
+        for (const auto& [id, image]: std::views::enumerate(streamedImages_)) {
+            if (idle(image) && image.wantedMip > image.firstMip) {
+                request(id, image.wantedMip);
+            }
+        }
+
+        // Over budget, the least recently sampled images lose levels until
+        // the rest fit. Images sampled lately lose one level at a time, so
+        // quality degrades gradually rather than falling back to the tail.
+        if (projectedBytes > streamingBudget_) {
+            auto candidates = std::views::iota(0uz, streamedImages_.size()) | std::views::filter([&](size_t id) {
+                                  const auto& image = streamedImages_[id];
+                                  return idle(image) && image.firstMip < image.tailMip;
+                              }) |
+                              std::ranges::to<std::vector>();
+            std::ranges::sort(candidates, {}, [this](size_t id) { return streamedImages_[id].lastSampledFrame; });
+
+            for (const auto id: candidates) {
+                if (projectedBytes <= streamingBudget_) {
+                    break;
                 }
-        },
-            {}
+                const auto& image = streamedImages_[id];
+                const bool stale = frameNumber_ - image.lastSampledFrame > Viewport::maxFramesInFlight;
+                request(id, stale ? image.tailMip : image.firstMip + 1);
+                evictions_++;
+            }
+            return;
+        }
+
+        for (const auto& [id, image]: std::views::enumerate(streamedImages_)) {
+            if (!idle(image) || image.wantedMip >= image.firstMip || frameNumber_ < image.retryFrame) {
+                continue;
+            }
+
+            const auto growth = residentBytes(image, image.wantedMip) - residentBytes(image, image.firstMip);
+            if (inFlight >= maxStreamingRequests || projectedBytes + growth > streamingBudget_) {
+                continue;
+            }
+            inFlight++;
+            request(id, image.wantedMip);
+        }
+    }
+
+    vk::DeviceSize TextureManager::residentBytes(const StreamedImage& image, uint32_t firstMip) {
+        return std::ranges::fold_left(
+            image.source.levelSizes | std::views::drop(firstMip), vk::DeviceSize{0}, std::plus{}
         );
+    }
 
-        return handle;
+    vk::DeviceAddress TextureManager::feedbackAddress(uint32_t frameIndex) const {
+        return feedbackBuffer_.getAddress() + feedbackBlockSize() * frameIndex;
+    }
+
+    vk::DeviceSize TextureManager::feedbackBlockSize() const { return capacity() * sizeof(uint32_t); }
+
+    vk::DeviceAddress TextureManager::slotsAddress(uint32_t frameIndex) const {
+        return slotBuffer_.getAddress(frameIndex);
+    }
+
+    TextureStreamingStats TextureManager::streamingStats() const {
+        return {
+            .streamedImages = static_cast<size_t>(std::ranges::count_if(streamedImages_, [](const auto& image) {
+                return image.image != nullptr;
+            })),
+            .requestsInFlight = static_cast<size_t>(std::ranges::count_if(streamedImages_, [](const auto& image) {
+                return image.requestedMip.has_value();
+            })),
+            .evictions = evictions_,
+            .residentBytes = residentBytes_,
+            .budget = streamingBudget_,
+            .otherBytes = otherBytes_,
+            .overBudget = overBudget_,
+            .device = deviceBudget_,
+        };
+    }
+
+    size_t TextureManager::TextureKeyHash::operator()(const TextureKey& key) const {
+        auto hash = hashCombine(key.contentHash, static_cast<uint64_t>(key.role));
+        return hashCombine(hash, SamplerInfoHash{}(key.sampler));
     }
 
     void TextureManager::createErrorTexture() {
@@ -70,30 +576,17 @@ namespace yuubi {
 
         auto errorCheckerboardImage = createImageFromData(*device_, imageData);
         auto errorCheckerboardView = device_->createImageView(
-            *errorCheckerboardImage.getImage(), vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor
+            *errorCheckerboardImage.getImage(), vk::Format::eR8G8B8A8Srgb, vk::ImageAspectFlagBits::eColor, 1,
+            vk::ImageViewType::e2D, vk::ImageUsageFlagBits::eSampled
         );
 
-        // TODO: write createSampler() member function on Device
-        auto errorCheckerboardSampler = device_->getDevice().createSampler(vk::SamplerCreateInfo{
-            .magFilter = vk::Filter::eLinear,
-            .minFilter = vk::Filter::eLinear,
-            .mipmapMode = vk::SamplerMipmapMode::eLinear,
-            .addressModeU = vk::SamplerAddressMode::eRepeat,
-            .addressModeV = vk::SamplerAddressMode::eRepeat,
-            .addressModeW = vk::SamplerAddressMode::eRepeat,
-            .mipLodBias = 0.0f,
-            .anisotropyEnable = vk::True,
-            .maxAnisotropy = device_->getPhysicalDevice().getProperties().limits.maxSamplerAnisotropy,
-            .compareEnable = vk::False,
-            .compareOp = vk::CompareOp::eAlways,
-            .minLod = 0.0f,
-            .maxLod = 0.0f,
-            .borderColor = vk::BorderColor::eIntOpaqueBlack,
-            .unnormalizedCoordinates = vk::False,
-        });
-
         const auto errorCheckerboardTexture = std::make_shared<Texture>(
-            std::move(errorCheckerboardImage), std::move(errorCheckerboardView), std::move(errorCheckerboardSampler)
+            std::make_shared<const TextureImage>(std::move(errorCheckerboardImage), std::move(errorCheckerboardView)),
+            device_->samplerCache().get({
+                .magFilter = vk::Filter::eLinear,
+                .minFilter = vk::Filter::eLinear,
+                .mipmapMode = vk::SamplerMipmapMode::eLinear,
+            })
         );
         addResource(errorCheckerboardTexture);
     }
@@ -1,64 +1,266 @@
 #pragma once
 
+#include "renderer/gltf/ktx_image_data.h"
+#include "renderer/dynamic_buffer.h"
 #include "renderer/resources/resource_manager.h"
+#include "renderer/resources/texture_streamer.h"
+#include "renderer/sampler_cache.h"
 #include "renderer/vulkan_usage.h"
 #include "pch.h"
+#include "renderer/vma/allocator.h"
+#include "renderer/vma/buffer.h"
 #include "renderer/vma/image.h"
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
 
 namespace yuubi {
 
-    // TODO: Find right limit.
-    constexpr uint32_t maxTextures = 1024;
+    // Every texture owns two descriptors and alternates between them when its
+    // image is replaced, so a descriptor frames in flight may read is never
+    // rewritten. Shaders look the current one up in a per-frame slot table.
+    constexpr uint32_t descriptorsPerTexture = 2;
 
-    struct Texture : NonCopyable {
-        Texture() = default;
-        Texture(Image&& image, vk::raii::ImageView&& imageView, vk::raii::Sampler&& sampler) :
-            image(std::move(image)), imageView(std::move(imageView)), sampler(std::move(sampler)) {}
+    // A resident image and its view, shared by every texture that samples it.
+    struct TextureImage : NonCopyable {
+        TextureImage() = default;
+        TextureImage(Image&& image, vk::raii::ImageView&& imageView) :
+            image(std::move(image)), imageView(std::move(imageView)) {}
 
-        Texture(Texture&& rhs) noexcept :
-            image(std::exchange(rhs.image, {})), imageView(std::exchange(rhs.imageView, nullptr)),
-            sampler(std::exchange(rhs.sampler, nullptr)) {};
-        Texture& operator=(Texture&& rhs) noexcept {
+        TextureImage(TextureImage&& rhs) noexcept :
+            image(std::exchange(rhs.image, {})), imageView(std::exchange(rhs.imageView, nullptr)) {};
+        TextureImage& operator=(TextureImage&& rhs) noexcept {
             if (this != &rhs) {
                 std::swap(image, rhs.image);
                 std::swap(imageView, rhs.imageView);
-                std::swap(sampler, rhs.sampler);
             }
             return *this;
         }
 
         Image image;
         vk::raii::ImageView imageView = nullptr;
-        vk::raii::Sampler sampler = nullptr;
     };
 
-    using TextureHandle = uint32_t;
+    struct Texture {
+        std::shared_ptr<const TextureImage> image;
+        // Owned by the device's SamplerCache.
+        vk::Sampler sampler;
+    };
 
     class Device;
-    class TextureManager final : ResourceManager<Texture, maxTextures>, NonCopyable {
+    // Creates the view textures sample image through, covering all its levels.
+    [[nodiscard]] std::shared_ptr<const TextureImage> makeTextureImage(const Device& device, Image&& image);
+
+    // KTX2 file holding the full mip chain of a streamed image.
+    struct StreamingSource {
+        std::filesystem::path path;
+        // Bytes of each level, finest first.
+        std::vector<vk::DeviceSize> levelSizes;
+    };
+
+    struct TextureStreamingStats {
+        size_t streamedImages = 0;
+        size_t requestsInFlight = 0;
+        // Levels dropped to get back under the budget.
+        uint64_t evictions = 0;
+        vk::DeviceSize residentBytes = 0;
+        vk::DeviceSize budget = 0;
+        // Device-local usage streaming can't reclaim: meshes, textures that
+        // aren't streamed and render targets.
+        vk::DeviceSize otherBytes = 0;
+        // Set while the streamed images don't fit the budget even with every
+        // one of them down to its mip tail.
+        bool overBudget = false;
+        MemoryBudget device;
+    };
+
+    using TextureHandle = uint32_t;
+
+    // Identifies a texture by content: a hash of the encoded bytes of its
+    // image, the role the image was loaded for, which decides its format, and
+    // its sampler.
+    struct TextureKey {
+        uint64_t contentHash = 0;
+        TextureRole role = TextureRole::Color;
+        SamplerInfo sampler;
+
+        bool operator==(const TextureKey&) const = default;
+    };
+
+    struct TextureCacheStats {
+        // Lookups that found a resident texture.
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t cachedTextures = 0;
+    };
+
+    // Bindless table of every resident texture.
+    //
+    // Textures added with addCached() are also cached by content across
+    // assets, so loading an image that is already resident, from any file or
+    // from a reload, hands out the existing handle instead of decoding and
+    // uploading it again. Cached textures are reference counted and removed
+    // when their last reference is released; their images and descriptors
+    // are recycled once the frames in flight have finished with them.
+    //
+    // Images whose full mip chain is on disk can be streamed. They are
+    // uploaded with only their mip tail, and the mesh pass records the finest
+    // level each texture is sampled at. beginFrame() reads that back, streams
+    // finer levels in while they fit the budget and drops levels that have
+    // gone unsampled for a while.
+    //
+    // The streaming budget follows the device-local heap budget, leaving
+    // room for everything else the process allocates. When it shrinks below
+    // what is resident, the least recently sampled images lose levels until
+    // they fit; they stream back in once sampled with room to spare.
+    // Everything else in device-local memory counts against the budget but
+    // is never evicted; if it leaves too little room, that is logged.
+    //
+    // Descriptor writes are queued and applied together in beginFrame(), so
+    // an asset adding thousands of textures costs a single descriptor update.
+    class TextureManager final : ResourceManager<Texture>, NonCopyableOrMovable {
     public:
-        TextureManager() = default;
+        // Levels no larger than this many texels a side stay resident.
+        static constexpr uint32_t streamingTailSize = 128;
+        // Upper bound of the streaming budget, however much the heap allows.
+        static constexpr vk::DeviceSize defaultStreamingBudget = 512ull * 1024 * 1024;
+        // Upper bound of the texture table, however many descriptors the
+        // device allows, as per-frame work scales with the textures in use.
+        static constexpr uint32_t maxCapacity = 1u << 16;
+
+        // textureSet must hold descriptorsPerTexture * deviceCapacity(device)
+        // descriptors.
         TextureManager(std::shared_ptr<Device> device, std::shared_ptr<vk::raii::DescriptorSet> textureSet);
-        TextureManager(TextureManager&& rhs) noexcept :
-            ResourceManager(std::move(rhs)), device_(std::exchange(rhs.device_, nullptr)),
-            textureSet_(std::exchange(rhs.textureSet_, nullptr)) {};
 
-        TextureManager& operator=(TextureManager&& rhs) noexcept {
-            if (this != &rhs) {
-                ResourceManager::operator=(std::move(rhs));
-                std::swap(device_, rhs.device_);
-                std::swap(textureSet_, rhs.textureSet_);
-            }
-            return *this;
-        }
+        // Textures the table holds on device, which is limited by its
+        // update-after-bind descriptor limits.
+        [[nodiscard]] static uint32_t deviceCapacity(const Device& device);
+        using ResourceManager::capacity;
 
         virtual ResourceHandle addResource(const std::shared_ptr<Texture>& texture) override;
 
+        // Returns the handle of the texture cached under key and takes a
+        // reference on it. Thread-safe.
+        [[nodiscard]] std::optional<ResourceHandle> acquireCached(const TextureKey& key);
+        // Returns the image of a cached texture with the given content, which
+        // a texture with another sampler can share. Thread-safe.
+        [[nodiscard]] std::shared_ptr<const TextureImage> findCachedImage(
+            uint64_t contentHash, TextureRole role
+        ) const;
+        // Adds texture and caches it under key with one reference. Returns the
+        // existing handle instead if another load cached key first, and
+        // nothing if the texture table is full. Must be called on the render
+        // thread.
+        std::optional<ResourceHandle> addCached(const TextureKey& key, const std::shared_ptr<Texture>& texture);
+        // Drops a reference taken by acquireCached() or addCached(), and
+        // removes the texture if it was the last one. Must be called on the
+        // render thread.
+        void release(ResourceHandle handle);
+
+        [[nodiscard]] TextureCacheStats cacheStats() const;
+
+        // First level of a width x height image with mipLevels levels that
+        // stays resident while it is streamed.
+        [[nodiscard]] static uint32_t streamingTailMip(uint32_t width, uint32_t height, uint32_t mipLevels);
+        // Streams the image of handle from source, which was uploaded from
+        // firstMip on. Textures sharing the image are streamed with it. Must
+        // be called on the render thread.
+        void stream(ResourceHandle handle, StreamingSource source, uint32_t firstMip);
+        // Reads back the feedback of the frame that last used frameIndex,
+        // swaps in streamed images and writes the slot table for the frame.
+        // Must be called on the render thread once that frame has finished.
+        void beginFrame(uint32_t frameIndex);
+
+        [[nodiscard]] vk::DeviceAddress feedbackAddress(uint32_t frameIndex) const;
+        [[nodiscard]] vk::DeviceAddress slotsAddress(uint32_t frameIndex) const;
+        [[nodiscard]] TextureStreamingStats streamingStats() const;
+
     private:
+        struct TextureKeyHash {
+            size_t operator()(const TextureKey& key) const;
+        };
+
+        struct CacheEntry {
+            ResourceHandle handle;
+            uint32_t references;
+        };
+
+        struct StreamedImage {
+            StreamingSource source;
+            std::shared_ptr<const TextureImage> image;
+            // Textures sampling the image.
+            std::vector<ResourceHandle> handles;
+            uint32_t firstMip;
+            uint32_t tailMip;
+            // Finest level sampled lately, kept until the image has been
+            // sampled coarser for streamingEvictionFrames.
+            uint32_t wantedMip;
+            uint64_t wantedFrame = 0;
+            uint64_t lastSampledFrame = 0;
+            // Level the request in flight streams from.
+            std::optional<uint32_t> requestedMip;
+            // Frame before which a stream-in that ran out of memory isn't
+            // retried.
+            uint64_t retryFrame = 0;
+            // Streamed image waiting for the texture's other descriptors to
+            // be out of use.
+            std::optional<TextureStreamer::Result> pending;
+            uint64_t swapFrame = 0;
+            // Set if the file could not be streamed, which isn't retried.
+            bool failed = false;
+        };
+
         void createErrorTexture();
+        // Queues a write of the current descriptor of handle.
+        void writeDescriptor(ResourceHandle handle);
+        void flushDescriptorWrites();
+        [[nodiscard]] vk::DeviceSize feedbackBlockSize() const;
+        // Joins handle to the streamed image it samples, if any.
+        bool shareStream(ResourceHandle handle);
+        // Stops streaming the image of a removed texture once no other
+        // texture samples it.
+        void unstream(ResourceHandle handle);
+        void updateStreamingBudget();
+        void readFeedback(uint32_t frameIndex);
+        void swapStreamedImages();
+        void requestStreaming();
+        [[nodiscard]] static vk::DeviceSize residentBytes(const StreamedImage& image, uint32_t firstMip);
 
         std::shared_ptr<Device> device_;
         std::shared_ptr<vk::raii::DescriptorSet> textureSet_;
+
+        mutable std::mutex cacheMutex_;
+        std::unordered_map<TextureKey, CacheEntry, TextureKeyHash> cache_;
+        // Cached textures by image content hash and role, to share their
+        // images with. Streaming replaces images, so the texture is looked up
+        // instead of keeping the image.
+        std::map<std::pair<uint64_t, TextureRole>, ResourceHandle> images_;
+        TextureCacheStats stats_;
+
+        // Only accessed on the render thread.
+        std::vector<std::pair<uint32_t, vk::DescriptorImageInfo>> descriptorWrites_;
+
+        // Streaming state. Only accessed on the render thread.
+        std::vector<StreamedImage> streamedImages_;
+        // Descriptor each texture is sampled through, copied to slotBuffer_
+        // every frame.
+        std::vector<uint32_t> descriptorSlots_;
+        // Finest level sampled per texture, one block of capacity() per frame
+        // in flight.
+        Buffer feedbackBuffer_;
+        DynamicBuffer slotBuffer_;
+        // Replaced images, kept until frames that may sample them finish.
+        std::deque<std::pair<uint64_t, std::shared_ptr<const TextureImage>>> retiredImages_;
+        vk::DeviceSize maxStreamingBudget_ = defaultStreamingBudget;
+        vk::DeviceSize streamingBudget_ = defaultStreamingBudget;
+        MemoryBudget deviceBudget_;
+        vk::DeviceSize residentBytes_ = 0;
+        vk::DeviceSize otherBytes_ = 0;
+        uint64_t evictions_ = 0;
+        bool overBudget_ = false;
+        uint64_t frameNumber_ = 0;
+        std::unique_ptr<TextureStreamer> streamer_;
     };
 
 }
@@ -0,0 +1,84 @@
+#include "renderer/resources/texture_streamer.h"
+
+#include "core/io/mapped_file.h"
+#include "renderer/device.h"
+#include "renderer/gltf/ktx_image_data.h"
+#include "renderer/resources/texture_manager.h"
+#include "renderer/upload_batcher.h"
+
+namespace yuubi {
+
+    TextureStreamer::TextureStreamer(const Device& device) :
+        device_(&device), thread_([this](const std::stop_token& stopToken) { run(stopToken); }) {}
+
+    void TextureStreamer::request(Request request) {
+        {
+            std::lock_guard lock(mutex_);
+            requests_.push_back(std::move(request));
+        }
+        requestAdded_.notify_one();
+    }
+
+    std::vector<TextureStreamer::Result> TextureStreamer::takeCompleted() {
+        const auto completedValue = device_->getUploadTimeline().getCounterValue();
+
+        std::lock_guard lock(mutex_);
+        const auto completed = std::ranges::partition(results_, [completedValue](const Result& result) {
+            return result.timelineValue > completedValue;
+        });
+        std::vector ready(std::make_move_iterator(completed.begin()), std::make_move_iterator(completed.end()));
+        results_.erase(completed.begin(), completed.end());
+        return ready;
+    }
+
+    void TextureStreamer::run(const std::stop_token& stopToken) {
+        UploadBatcher batcher(*device_);
+
+        while (!stopToken.stop_requested()) {
+            std::deque<Request> requests;
+            {
+                std::unique_lock lock(mutex_);
+                if (!requestAdded_.wait(lock, stopToken, [this] { return !requests_.empty(); })) {
+                    return;
+                }
+                requests.swap(requests_);
+            }
+
+            // Everything requested so far goes out in one submission.
+            std::vector<Result> results;
+            for (const auto& request: requests) {
+                auto& result = results.emplace_back(Result{.id = request.id, .firstMip = request.firstMip});
+
+                const MappedFile file(request.path);
+                if (!file.isOpen()) {
+                    UB_ERROR("Unable to stream {}", request.path.string());
+                    continue;
+                }
+                const auto bytes = file.bytes();
+                const KtxImageData imageData(
+                    {reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size()}, TextureRole::Color
+                );
+                const auto data = imageData.imageData();
+                if (data.pixels == nullptr || request.firstMip >= data.mipLevels.size()) {
+                    UB_ERROR("Unable to stream {}", request.path.string());
+                    continue;
+                }
+
+                auto image = batcher.createImage(mipTail(data, request.firstMip), request.withinBudget);
+                if (!image.isAllocated()) {
+                    result.outOfMemory = true;
+                    continue;
+                }
+                result.image = makeTextureImage(*device_, std::move(image));
+            }
+
+            const auto timelineValue = batcher.flush();
+            std::lock_guard lock(mutex_);
+            for (auto& result: results) {
+                result.timelineValue = timelineValue;
+                results_.push_back(std::move(result));
+            }
+        }
+    }
+
+}
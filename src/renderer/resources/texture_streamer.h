@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core/util.h"
+#include "renderer/vulkan_usage.h"
+#include "pch.h"
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+namespace yuubi {
+
+    class Device;
+    struct TextureImage;
+
+    // Reads mip levels of streamed images from their KTX2 files and uploads
+    // them on a thread of its own, so residency changes never stall the
+    // render loop. Every request produces a new image holding the levels from
+    // its first mip on; images that may be in use are never modified.
+    class TextureStreamer : NonCopyableOrMovable {
+    public:
+        struct Request {
+            uint32_t id;
+            std::filesystem::path path;
+            uint32_t firstMip;
+            // Fail instead of exceeding the heap budget.
+            bool withinBudget;
+        };
+
+        struct Result {
+            uint32_t id;
+            uint32_t firstMip;
+            // Null if the file could not be read or the image did not fit the
+            // budget.
+            std::shared_ptr<const TextureImage> image;
+            bool outOfMemory = false;
+            // Upload timeline value signalled once the image is written.
+            uint64_t timelineValue;
+        };
+
+        explicit TextureStreamer(const Device& device);
+
+        // Thread-safe.
+        void request(Request request);
+        // Returns the results whose uploads have completed. Thread-safe.
+        [[nodiscard]] std::vector<Result> takeCompleted();
+
+    private:
+        void run(const std::stop_token& stopToken);
+
+        const Device* device_;
+
+        std::mutex mutex_;
+        std::condition_variable_any requestAdded_;
+        std::deque<Request> requests_;
+        std::vector<Result> results_;
+
+        // Declared last so the thread is joined before anything it uses is
+        // destroyed.
+        std::jthread thread_;
+    };
+
+}
@@ -0,0 +1,39 @@
+#include "renderer/sampler_cache.h"
+
+#include "core/hash.h"
+
+namespace yuubi {
+
+    size_t SamplerInfoHash::operator()(const SamplerInfo& info) const {
+        auto hash = hashCombine(0, static_cast<uint64_t>(info.magFilter));
+        hash = hashCombine(hash, static_cast<uint64_t>(info.minFilter));
+        return hashCombine(hash, static_cast<uint64_t>(info.mipmapMode));
+    }
+
+    SamplerCache::SamplerCache(const vk::raii::Device& device, float maxAnisotropy) :
+        device_(&device), maxAnisotropy_(maxAnisotropy) {}
+
+    vk::Sampler SamplerCache::get(const SamplerInfo& info) {
+        std::lock_guard lock(mutex_);
+        if (const auto it = samplers_.find(info); it != samplers_.end()) {
+            return *it->second;
+        }
+
+        auto sampler = device_->createSampler(vk::SamplerCreateInfo{
+            .magFilter = info.magFilter,
+            .minFilter = info.minFilter,
+            .mipmapMode = info.mipmapMode,
+            .addressModeU = vk::SamplerAddressMode::eRepeat,
+            .addressModeV = vk::SamplerAddressMode::eRepeat,
+            .addressModeW = vk::SamplerAddressMode::eRepeat,
+            .anisotropyEnable = vk::True,
+            .maxAnisotropy = maxAnisotropy_,
+            .minLod = 0.0f,
+            .maxLod = vk::LodClampNone,
+        });
+        const auto& cached = samplers_.emplace(info, std::move(sampler)).first->second;
+        UB_INFO("Created sampler {}", samplers_.size());
+        return *cached;
+    }
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "core/util.h"
+#include "renderer/vulkan_usage.h"
+#include "pch.h"
+#include <mutex>
+
+namespace yuubi {
+
+    // Description of a texture sampler. Samplers filter anisotropically with
+    // the device's limit, repeat, and may sample every mip level of a view.
+    struct SamplerInfo {
+        vk::Filter magFilter = vk::Filter::eNearest;
+        vk::Filter minFilter = vk::Filter::eNearest;
+        vk::SamplerMipmapMode mipmapMode = vk::SamplerMipmapMode::eLinear;
+
+        bool operator==(const SamplerInfo&) const = default;
+    };
+
+    struct SamplerInfoHash {
+        size_t operator()(const SamplerInfo& info) const;
+    };
+
+    // Creates each distinct sampler once and hands out the same handle for
+    // every later request. Samplers live as long as the cache.
+    class SamplerCache : NonCopyableOrMovable {
+    public:
+        explicit SamplerCache(const vk::raii::Device& device, float maxAnisotropy);
+
+        // Thread-safe.
+        [[nodiscard]] vk::Sampler get(const SamplerInfo& info);
+
+    private:
+        const vk::raii::Device* device_;
+        float maxAnisotropy_;
+
+        std::mutex mutex_;
+        std::unordered_map<SamplerInfo, vk::raii::Sampler, SamplerInfoHash> samplers_;
+    };
+
+}
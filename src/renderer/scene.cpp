@@ -0,0 +1,124 @@
+#include "renderer/scene.h"
+#include "pch.h"
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace yuubi {
+
+    namespace {
+        // Each loading asset holds a loader thread and staging memory.
+        constexpr size_t maxConcurrentLoads = 4;
+    }
+
+    Scene::Scene(
+        Device& device, GeometryPool& geometryPool, TextureManager& textureManager, MaterialManager& materialManager
+    ) :
+        device_(&device), geometryPool_(&geometryPool), textureManager_(&textureManager),
+        materialManager_(&materialManager) {}
+
+    std::unique_ptr<Scene> Scene::load(
+        Device& device, GeometryPool& geometryPool, TextureManager& textureManager, MaterialManager& materialManager,
+        const std::filesystem::path& path
+    ) {
+        auto scene = std::make_unique<Scene>(device, geometryPool, textureManager, materialManager);
+        if (path.extension() != sceneFileExtension) {
+            scene->addInstance(scene->addAsset(path), glm::mat4{1.0f});
+            return scene;
+        }
+
+        std::ifstream file(path);
+        if (!file) {
+            UB_ERROR("Failed to open scene file: {}", path.string());
+            return scene;
+        }
+
+        size_t instances = 0;
+        std::string line;
+        for (size_t lineNumber = 1; std::getline(file, line); lineNumber++) {
+            std::istringstream stream(line);
+            std::string assetPath;
+            if (!(stream >> std::quoted(assetPath)) || assetPath.starts_with('#')) {
+                continue;
+            }
+
+            // Translation, rotation and scale.
+            std::array values{0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+            size_t count = 0;
+            while (count < values.size() && stream >> values[count]) {
+                count++;
+            }
+            stream.clear();
+            if (!(stream >> std::ws).eof() || (count != 0 && count != 3 && count != 6 && count != 7)) {
+                UB_ERROR(
+                    "{}:{}: expected an asset path followed by 0, 3, 6 or 7 numbers", path.string(), lineNumber
+                );
+                continue;
+            }
+
+            const glm::vec3 translation{values[0], values[1], values[2]};
+            const glm::quat rotation{glm::radians(glm::vec3{values[3], values[4], values[5]})};
+            const auto transform = glm::translate(glm::mat4{1.0f}, translation) * glm::mat4_cast(rotation) *
+                                   glm::scale(glm::mat4{1.0f}, glm::vec3{values[6]});
+            scene->addInstance(scene->addAsset(path.parent_path() / assetPath), transform);
+            instances++;
+        }
+
+        UB_INFO("Loaded scene file {}: {} instances of {} assets", path.string(), instances, scene->assets_.size());
+        return scene;
+    }
+
+    Scene::AssetId Scene::addAsset(const std::filesystem::path& path) {
+        const auto key = std::filesystem::absolute(path).lexically_normal();
+        const auto [it, inserted] = assetIds_.try_emplace(key, static_cast<AssetId>(assets_.size()));
+        if (inserted) {
+            assets_.push_back({.path = key});
+        }
+        return it->second;
+    }
+
+    void Scene::addInstance(AssetId asset, const glm::mat4& transform) {
+        assets_.at(asset).instances.push_back(transform);
+    }
+
+    void Scene::update(const vk::raii::CommandBuffer& commandBuffer) {
+        auto loading = static_cast<size_t>(std::ranges::count_if(assets_, [](const PlacedAsset& placed) {
+            return placed.asset != nullptr && placed.asset->isLoading();
+        }));
+
+        for (auto& placed: assets_) {
+            if (placed.asset == nullptr && loading < maxConcurrentLoads) {
+                placed.asset = GLTFAsset::loadAsync(
+                    *device_, *geometryPool_, *textureManager_, *materialManager_, placed.path
+                );
+                loading++;
+            }
+            if (placed.asset != nullptr) {
+                placed.asset->update(commandBuffer);
+            }
+        }
+    }
+
+    void Scene::draw(const glm::mat4& topMatrix, DrawContext& context) {
+        for (const auto& placed: assets_) {
+            if (placed.asset == nullptr) {
+                continue;
+            }
+            for (const auto& transform: placed.instances) {
+                placed.asset->draw(topMatrix * transform, context);
+            }
+        }
+    }
+
+    SceneStats Scene::stats() const {
+        SceneStats stats{.assets = assets_.size()};
+        for (const auto& placed: assets_) {
+            stats.loadedAssets += placed.asset != nullptr && placed.asset->isLoaded() ? 1 : 0;
+            stats.instances += placed.instances.size();
+        }
+        return stats;
+    }
+
+}
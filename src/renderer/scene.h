@@ -0,0 +1,87 @@
+#pragma once
+
+#include "renderer/gltf/asset.h"
+#include "renderer/render_object.h"
+#include "renderer/vulkan_usage.h"
+#include "pch.h"
+#include <filesystem>
+#include <map>
+#include <glm/glm.hpp>
+
+namespace yuubi {
+
+    class Device;
+    class GeometryPool;
+    class TextureManager;
+    class MaterialManager;
+
+    constexpr std::string_view sceneFileExtension = ".ybscene";
+
+    struct SceneStats {
+        size_t assets = 0;
+        size_t loadedAssets = 0;
+        size_t instances = 0;
+    };
+
+    // Assets placed any number of times. Each asset is loaded once and every
+    // instance of it draws its meshes, materials and textures with its own
+    // transform, so an instance costs a matrix rather than a copy of the
+    // asset. Assets are loaded a few at a time in the background and draw
+    // as they fill in.
+    //
+    // A scene file lists one instance per line: an asset path, relative to
+    // the file, followed by an optional translation, rotation in degrees
+    // about x, y and z, and uniform scale.
+    //
+    //     # asset                      x y z   rx ry rz  scale
+    //     props/crate.ybasset          0 0 0
+    //     props/crate.ybasset          2 0 0   0 45 0
+    //     "props/old lamp.gltf"        0 3 1   0 0 0     0.5
+    class Scene final : NonCopyableOrMovable, public Renderable {
+    public:
+        using AssetId = uint32_t;
+
+        Scene(
+            Device& device, GeometryPool& geometryPool, TextureManager& textureManager, MaterialManager& materialManager
+        );
+
+        // Reads the scene file at path, or places the glTF or cooked asset at
+        // path once at the origin. Malformed scene file lines are logged and
+        // skipped.
+        [[nodiscard]] static std::unique_ptr<Scene> load(
+            Device& device, GeometryPool& geometryPool, TextureManager& textureManager,
+            MaterialManager& materialManager, const std::filesystem::path& path
+        );
+
+        // Returns the id of the asset at path, queuing it to load the first
+        // time it is added.
+        AssetId addAsset(const std::filesystem::path& path);
+        void addInstance(AssetId asset, const glm::mat4& transform);
+
+        // Starts queued loads and applies finished loading work. Must be
+        // called on the render thread with commandBuffer recording the next
+        // frame, before any pass.
+        void update(const vk::raii::CommandBuffer& commandBuffer);
+
+        void draw(const glm::mat4& topMatrix, DrawContext& context) override;
+
+        [[nodiscard]] SceneStats stats() const;
+
+    private:
+        struct PlacedAsset {
+            std::filesystem::path path;
+            // Null until its load starts.
+            std::unique_ptr<GLTFAsset> asset;
+            std::vector<glm::mat4> instances;
+        };
+
+        Device* device_;
+        GeometryPool* geometryPool_;
+        TextureManager* textureManager_;
+        MaterialManager* materialManager_;
+
+        std::vector<PlacedAsset> assets_;
+        std::map<std::filesystem::path, AssetId> assetIds_;
+    };
+
+}
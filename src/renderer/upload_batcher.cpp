@@ -0,0 +1,515 @@
+#include "renderer/upload_batcher.h"
+#include "core/pixels.h"
+#include "renderer/device.h"
+#include "renderer/vma/image.h"
+#include "renderer/vulkan/util.h"
+
+namespace {
+
+    vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool isRgba8(vk::Format format) {
+        return format == vk::Format::eR8G8B8A8Unorm || format == vk::Format::eR8G8B8A8Srgb;
+    }
+
+    // Fallback for formats the MipGenerator can't write. Each level is blitted
+    // from the previous one once its blit has completed.
+    void blitMipmaps(const vk::raii::CommandBuffer& commandBuffer, const yuubi::MipGenerator::Request& request) {
+        int32_t mipWidth = request.width;
+        int32_t mipHeight = request.height;
+
+        for (uint32_t i = 1; i < request.mipLevels; i++) {
+            const vk::ImageMemoryBarrier2 barrier{
+                .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+                .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+                .dstAccessMask = vk::AccessFlagBits2::eTransferRead,
+                .oldLayout = vk::ImageLayout::eGeneral,
+                .newLayout = vk::ImageLayout::eGeneral,
+                .image = request.image,
+                .subresourceRange{
+                                  .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                  .baseMipLevel = i - 1,
+                                  .levelCount = 1,
+                                  .baseArrayLayer = 0,
+                                  .layerCount = 1
+                }
+            };
+            commandBuffer.pipelineBarrier2({.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &barrier});
+
+            std::array<vk::Offset3D, 2> srcOffsets{
+                {{.x = 0, .y = 0, .z = 0}, {.x = mipWidth, .y = mipHeight, .z = 1}}
+            };
+            std::array<vk::Offset3D, 2> dstOffsets{
+                {{.x = 0, .y = 0, .z = 0},
+                 {.x = mipWidth > 1 ? mipWidth / 2 : 1, .y = mipHeight > 1 ? mipHeight / 2 : 1, .z = 1}}
+            };
+
+            vk::ImageBlit2 blit{
+                .srcSubresource =
+                    vk::ImageSubresourceLayers{
+                                               .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                               .mipLevel = i - 1,
+                                               .baseArrayLayer = 0,
+                                               .layerCount = 1,
+                                               },
+                .srcOffsets = srcOffsets,
+                .dstSubresource =
+                    vk::ImageSubresourceLayers{
+                                               .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                               .mipLevel = i,
+                                               .baseArrayLayer = 0,
+                                               .layerCount = 1
+                    },
+                .dstOffsets = dstOffsets,
+            };
+
+            commandBuffer.blitImage2(
+                vk::BlitImageInfo2{
+                    .srcImage = request.image,
+                    .srcImageLayout = vk::ImageLayout::eGeneral,
+                    .dstImage = request.image,
+                    .dstImageLayout = vk::ImageLayout::eGeneral,
+                    .regionCount = 1,
+                    .pRegions = &blit,
+                    .filter = vk::Filter::eLinear,
+                }
+            );
+
+            if (mipWidth > 1) mipWidth /= 2;
+            if (mipHeight > 1) mipHeight /= 2;
+        }
+    }
+
+}
+
+namespace yuubi {
+
+    UploadBatcher::UploadBatcher(const Device& device, vk::DeviceSize maxStagingBytes) :
+        device_(&device), maxStagingBytes_(maxStagingBytes) {
+        transferCommandPool_ = vk::raii::CommandPool{
+            device_->getDevice(),
+            {.flags = vk::CommandPoolCreateFlagBits::eTransient,
+              .queueFamilyIndex = device_->getTransferQueue().familyIndex}
+        };
+        graphicsCommandPool_ = vk::raii::CommandPool{
+            device_->getDevice(),
+            {.flags = vk::CommandPoolCreateFlagBits::eTransient, .queueFamilyIndex = device_->getQueue().familyIndex}
+        };
+    }
+
+    UploadBatcher::UploadBatcher(UploadBatcher&& rhs) noexcept :
+        device_(std::exchange(rhs.device_, nullptr)), stagingHead_(std::exchange(rhs.stagingHead_, 0)),
+        stagingBytes_(std::exchange(rhs.stagingBytes_, 0)), maxStagingBytes_(std::exchange(rhs.maxStagingBytes_, 0)),
+        transferCommandPool_(std::exchange(rhs.transferCommandPool_, nullptr)),
+        graphicsCommandPool_(std::exchange(rhs.graphicsCommandPool_, nullptr)),
+        batch_(std::exchange(rhs.batch_, {})), recording_(std::exchange(rhs.recording_, false)),
+        bufferOwnershipBarriers_(std::move(rhs.bufferOwnershipBarriers_)),
+        imageOwnershipBarriers_(std::move(rhs.imageOwnershipBarriers_)),
+        mipGenerations_(std::move(rhs.mipGenerations_)), blitMipGenerations_(std::move(rhs.blitMipGenerations_)),
+        inFlightBatches_(std::move(rhs.inFlightBatches_)),
+        lastTimelineValue_(std::exchange(rhs.lastTimelineValue_, 0)),
+        pendingUploads_(std::exchange(rhs.pendingUploads_, 0)), pendingBytes_(std::exchange(rhs.pendingBytes_, 0)) {}
+
+    UploadBatcher& UploadBatcher::operator=(UploadBatcher&& rhs) noexcept {
+        if (this != &rhs) {
+            std::swap(device_, rhs.device_);
+            std::swap(stagingHead_, rhs.stagingHead_);
+            std::swap(stagingBytes_, rhs.stagingBytes_);
+            std::swap(maxStagingBytes_, rhs.maxStagingBytes_);
+            std::swap(transferCommandPool_, rhs.transferCommandPool_);
+            std::swap(graphicsCommandPool_, rhs.graphicsCommandPool_);
+            std::swap(batch_, rhs.batch_);
+            std::swap(recording_, rhs.recording_);
+            std::swap(bufferOwnershipBarriers_, rhs.bufferOwnershipBarriers_);
+            std::swap(imageOwnershipBarriers_, rhs.imageOwnershipBarriers_);
+            std::swap(mipGenerations_, rhs.mipGenerations_);
+            std::swap(blitMipGenerations_, rhs.blitMipGenerations_);
+            std::swap(inFlightBatches_, rhs.inFlightBatches_);
+            std::swap(lastTimelineValue_, rhs.lastTimelineValue_);
+            std::swap(pendingUploads_, rhs.pendingUploads_);
+            std::swap(pendingBytes_, rhs.pendingBytes_);
+        }
+
+        return *this;
+    }
+
+    UploadBatcher::~UploadBatcher() {
+        if (device_ != nullptr) {
+            flush();
+            wait();
+        }
+    }
+
+    StagingAllocation UploadBatcher::allocateStaging(vk::DeviceSize size, vk::DeviceSize alignment) {
+        auto offset = alignUp(stagingHead_, alignment);
+        if (batch_.stagingBlocks.empty() || offset + size > batch_.stagingBlocks.back()->size) {
+            // Bound the staging memory held by this batcher. Submitting the
+            // current batch lets its memory be recycled once it retires.
+            if (stagingBytes_ + std::max(size, StagingAllocator::defaultBlockSize) > maxStagingBytes_) {
+                flush();
+                retireBatches(true);
+            }
+
+            const auto& block = batch_.stagingBlocks.emplace_back(device_->stagingAllocator().acquire(size));
+            stagingBytes_ += block->size;
+            offset = 0;
+        }
+        stagingHead_ = offset + size;
+
+        const auto& block = *batch_.stagingBlocks.back();
+        return StagingAllocation{
+            .memory = {block.data() + offset, size},
+            .buffer = *block.buffer.getBuffer(),
+            .offset = offset
+        };
+    }
+
+    void UploadBatcher::uploadBuffer(
+        const Buffer& buffer, const void* data, vk::DeviceSize size, vk::DeviceSize offset
+    ) {
+        const auto staging = allocateStaging(size);
+        std::memcpy(staging.memory.data(), data, size);
+
+        const vk::BufferCopy copyRegion{.srcOffset = staging.offset, .dstOffset = offset, .size = size};
+        transferCommandBuffer().copyBuffer(staging.buffer, *buffer.getBuffer(), {copyRegion});
+
+        releaseToGraphics(
+            vk::BufferMemoryBarrier2{.buffer = *buffer.getBuffer(), .offset = offset, .size = size}
+        );
+
+        pendingUploads_++;
+        pendingBytes_ += size;
+    }
+
+    Image UploadBatcher::createImage(const ImageData& data, bool withinBudget) {
+        // Block-compressed images can't be blitted, so they must come with
+        // their mip chain.
+        const bool prebuiltMips = !data.mipLevels.empty();
+
+        // Pixels with fewer channels than an RGBA format are expanded while
+        // they are copied into staging memory.
+        const bool expand = !prebuiltMips && data.numChannels < 4 && isRgba8(data.format);
+        const uint32_t numChannels = expand ? 4 : data.numChannels;
+        // Only the range covering the given levels is copied, so a mip tail
+        // doesn't drag the rest of the chain through staging memory.
+        const vk::DeviceSize dataOffset =
+            prebuiltMips ? std::ranges::min(data.mipLevels | std::views::transform(&ImageMipLevel::offset)) : 0;
+        const vk::DeviceSize imageSize =
+            prebuiltMips ? std::ranges::max(data.mipLevels | std::views::transform([](const auto& level) {
+                                                return level.offset + level.size;
+                                            })) -
+                               dataOffset
+                         : static_cast<vk::DeviceSize>(data.width) * data.height * numChannels;
+
+        const uint32_t mipLevels =
+            prebuiltMips ? static_cast<uint32_t>(data.mipLevels.size())
+                         : static_cast<uint32_t>(std::floor(std::log2(std::max(data.width, data.height)))) + 1;
+
+        // Mips are generated by the MipGenerator where the format allows it,
+        // and blitted otherwise.
+        const bool computeMips = !prebuiltMips && mipLevels > 1 && device_->mipGenerator().supportsFormat(data.format);
+        const auto mipRequirements =
+            computeMips ? MipGenerator::imageRequirements(data.format) : MipGenerator::ImageRequirements{};
+
+        Image image(
+            &device_->allocator(), ImageCreateInfo{
+                                       .width = data.width,
+                                       .height = data.height,
+                                       .format = data.format,
+                                       .tiling = vk::ImageTiling::eOptimal,
+                                       .usage = vk::ImageUsageFlagBits::eSampled |
+                                                vk::ImageUsageFlagBits::eTransferSrc |
+                                                vk::ImageUsageFlagBits::eTransferDst | mipRequirements.usage,
+                                       .properties = vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                       .mipLevels = mipLevels,
+                                       .flags = mipRequirements.flags,
+                                       .viewFormats = mipRequirements.viewFormats,
+                                       .withinBudget = withinBudget
+                                   }
+        );
+        if (!image.isAllocated()) {
+            return image;
+        }
+
+        const auto staging = allocateStaging(imageSize);
+
+        if (expand) {
+            expandToRgba(
+                data.pixels, data.numChannels, static_cast<size_t>(data.width) * data.height,
+                reinterpret_cast<unsigned char*>(staging.memory.data())
+            );
+        } else {
+            std::memcpy(staging.memory.data(), data.pixels + dataOffset, imageSize);
+        }
+
+        const auto& cmd = transferCommandBuffer();
+        transitionImage(cmd, *image.getImage(), vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral);
+
+        const auto copyRegion = [&](uint32_t mipLevel, vk::DeviceSize offset) {
+            return vk::BufferImageCopy{
+                .bufferOffset = staging.offset + offset,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource =
+                    vk::ImageSubresourceLayers{
+                                               .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                               .mipLevel = mipLevel,
+                                               .baseArrayLayer = 0,
+                                               .layerCount = 1
+                    },
+                .imageOffset = {0, 0, 0},
+                .imageExtent =
+                    vk::Extent3D{
+                                               .width = std::max(data.width >> mipLevel, 1u),
+                                               .height = std::max(data.height >> mipLevel, 1u),
+                                               .depth = 1
+                    }
+            };
+        };
+
+        std::vector<vk::BufferImageCopy> copyRegions;
+        if (prebuiltMips) {
+            for (const auto& [i, level]: std::views::enumerate(data.mipLevels)) {
+                copyRegions.push_back(copyRegion(static_cast<uint32_t>(i), level.offset - dataOffset));
+            }
+        } else {
+            copyRegions.push_back(copyRegion(0, 0));
+        }
+        cmd.copyBufferToImage(staging.buffer, *image.getImage(), vk::ImageLayout::eGeneral, copyRegions);
+
+        releaseToGraphics(
+            vk::ImageMemoryBarrier2{
+                .oldLayout = vk::ImageLayout::eGeneral,
+                .newLayout = vk::ImageLayout::eGeneral,
+                .image = *image.getImage(),
+                .subresourceRange{
+                                  .aspectMask = vk::ImageAspectFlagBits::eColor,
+                                  .baseMipLevel = 0,
+                                  .levelCount = vk::RemainingMipLevels,
+                                  .baseArrayLayer = 0,
+                                  .layerCount = vk::RemainingArrayLayers
+                }
+        }
+        );
+
+        // Mipmaps are generated on the graphics queue after the image has
+        // been acquired there.
+        if (!prebuiltMips && mipLevels > 1) {
+            (computeMips ? mipGenerations_ : blitMipGenerations_)
+                .push_back({
+                    .image = *image.getImage(),
+                    .format = data.format,
+                    .width = data.width,
+                    .height = data.height,
+                    .mipLevels = mipLevels,
+                    .filter = data.mipFilter,
+                });
+        }
+
+        pendingUploads_++;
+        pendingBytes_ += imageSize;
+
+        return image;
+    }
+
+    uint64_t UploadBatcher::flush() {
+        if (!recording_) {
+            retireBatches(false);
+            return lastTimelineValue_;
+        }
+        recording_ = false;
+
+        // Make staging writes visible to the device.
+        for (const auto& block: batch_.stagingBlocks) {
+            block->buffer.flush(0, block->size);
+        }
+
+        const bool dedicatedTransfer = device_->hasDedicatedTransferQueue();
+        if (dedicatedTransfer) {
+            batch_.transferCommandBuffer.pipelineBarrier2(
+                vk::DependencyInfo{
+                    .bufferMemoryBarrierCount = static_cast<uint32_t>(bufferOwnershipBarriers_.size()),
+                    .pBufferMemoryBarriers = bufferOwnershipBarriers_.data(),
+                    .imageMemoryBarrierCount = static_cast<uint32_t>(imageOwnershipBarriers_.size()),
+                    .pImageMemoryBarriers = imageOwnershipBarriers_.data()
+                }
+            );
+            batch_.transferCommandBuffer.end();
+
+            batch_.graphicsCommandBuffer = std::move(
+                device_->getDevice().allocateCommandBuffers(
+                    {.commandPool = *graphicsCommandPool_,
+                     .level = vk::CommandBufferLevel::ePrimary,
+                     .commandBufferCount = 1}
+                )[0]
+            );
+            batch_.graphicsCommandBuffer.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+            // The matching acquire operations only use the destination masks.
+            for (auto& barrier: bufferOwnershipBarriers_) {
+                barrier.setSrcStageMask(vk::PipelineStageFlagBits2::eNone)
+                    .setSrcAccessMask(vk::AccessFlagBits2::eNone)
+                    .setDstStageMask(vk::PipelineStageFlagBits2::eAllCommands)
+                    .setDstAccessMask(vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite);
+            }
+            for (auto& barrier: imageOwnershipBarriers_) {
+                barrier.setSrcStageMask(vk::PipelineStageFlagBits2::eNone)
+                    .setSrcAccessMask(vk::AccessFlagBits2::eNone)
+                    .setDstStageMask(vk::PipelineStageFlagBits2::eAllCommands)
+                    .setDstAccessMask(vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite);
+            }
+            batch_.graphicsCommandBuffer.pipelineBarrier2(
+                vk::DependencyInfo{
+                    .bufferMemoryBarrierCount = static_cast<uint32_t>(bufferOwnershipBarriers_.size()),
+                    .pBufferMemoryBarriers = bufferOwnershipBarriers_.data(),
+                    .imageMemoryBarrierCount = static_cast<uint32_t>(imageOwnershipBarriers_.size()),
+                    .pImageMemoryBarriers = imageOwnershipBarriers_.data()
+                }
+            );
+        } else {
+            // Copies were recorded into the graphics command buffer, so a plain
+            // memory barrier orders them before mip generation.
+            const vk::MemoryBarrier2 barrier{
+                .srcStageMask = vk::PipelineStageFlagBits2::eTransfer,
+                .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                .dstStageMask = vk::PipelineStageFlagBits2::eTransfer,
+                .dstAccessMask = vk::AccessFlagBits2::eTransferRead | vk::AccessFlagBits2::eTransferWrite
+            };
+            batch_.graphicsCommandBuffer.pipelineBarrier2(
+                vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &barrier}
+            );
+        }
+
+        // The whole batch is mipped in one go.
+        batch_.mipResources = device_->mipGenerator().record(batch_.graphicsCommandBuffer, mipGenerations_);
+        for (const auto& mipGeneration: blitMipGenerations_) {
+            blitMipmaps(batch_.graphicsCommandBuffer, mipGeneration);
+        }
+        batch_.graphicsCommandBuffer.end();
+
+        if (dedicatedTransfer) {
+            batch_.copiesDone = vk::raii::Semaphore{device_->getDevice(), vk::SemaphoreCreateInfo{}};
+
+            const vk::CommandBufferSubmitInfo commandBufferSubmitInfo{.commandBuffer = *batch_.transferCommandBuffer};
+            const vk::SemaphoreSubmitInfo signalInfo{
+                .semaphore = *batch_.copiesDone, .stageMask = vk::PipelineStageFlagBits2::eAllCommands
+            };
+            device_->submit(
+                device_->getTransferQueue(),
+                vk::SubmitInfo2{
+                    .commandBufferInfoCount = 1,
+                    .pCommandBufferInfos = &commandBufferSubmitInfo,
+                    .signalSemaphoreInfoCount = 1,
+                    .pSignalSemaphoreInfos = &signalInfo
+                }
+            );
+        }
+        batch_.timelineValue = device_->submitUpload(*batch_.graphicsCommandBuffer, *batch_.copiesDone);
+        lastTimelineValue_ = batch_.timelineValue;
+
+        UB_INFO(
+            "Submitted {} uploads ({:.2f} MiB) on {} queue", pendingUploads_,
+            static_cast<double>(pendingBytes_) / (1024.0 * 1024.0), dedicatedTransfer ? "transfer" : "graphics"
+        );
+
+        inFlightBatches_.push_back(std::exchange(batch_, {}));
+        bufferOwnershipBarriers_.clear();
+        imageOwnershipBarriers_.clear();
+        mipGenerations_.clear();
+        blitMipGenerations_.clear();
+        stagingHead_ = 0;
+        pendingUploads_ = 0;
+        pendingBytes_ = 0;
+
+        retireBatches(false);
+        return lastTimelineValue_;
+    }
+
+    void UploadBatcher::wait() {
+        const auto& semaphore = device_->getUploadTimeline();
+        const auto result = device_->getDevice().waitSemaphores(
+            {.semaphoreCount = 1, .pSemaphores = &*semaphore, .pValues = &lastTimelineValue_},
+            std::numeric_limits<uint64_t>::max()
+        );
+        if (result != vk::Result::eSuccess) {
+            UB_ERROR("Failed to wait for uploads");
+        }
+
+        retireBatches(false);
+    }
+
+    void UploadBatcher::retireBatches(bool waitForBudget) {
+        const auto& semaphore = device_->getUploadTimeline();
+        while (!inFlightBatches_.empty()) {
+            auto& batch = inFlightBatches_.front();
+
+            if (semaphore.getCounterValue() < batch.timelineValue) {
+                if (!waitForBudget || stagingBytes_ <= maxStagingBytes_ / 2) {
+                    break;
+                }
+                const auto result = device_->getDevice().waitSemaphores(
+                    {.semaphoreCount = 1, .pSemaphores = &*semaphore, .pValues = &batch.timelineValue},
+                    std::numeric_limits<uint64_t>::max()
+                );
+                if (result != vk::Result::eSuccess) {
+                    UB_ERROR("Failed to wait for uploads");
+                }
+            }
+
+            for (auto& block: batch.stagingBlocks) {
+                stagingBytes_ -= block->size;
+                device_->stagingAllocator().release(std::move(block));
+            }
+            inFlightBatches_.pop_front();
+        }
+    }
+
+    const vk::raii::CommandBuffer& UploadBatcher::transferCommandBuffer() {
+        if (!recording_) {
+            const bool dedicatedTransfer = device_->hasDedicatedTransferQueue();
+            const auto& pool = dedicatedTransfer ? transferCommandPool_ : graphicsCommandPool_;
+            auto commandBuffer = std::move(
+                device_->getDevice().allocateCommandBuffers(
+                    {.commandPool = *pool, .level = vk::CommandBufferLevel::ePrimary, .commandBufferCount = 1}
+                )[0]
+            );
+            commandBuffer.begin({.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+            // Without a dedicated queue everything is recorded into the
+            // graphics command buffer.
+            (dedicatedTransfer ? batch_.transferCommandBuffer : batch_.graphicsCommandBuffer) =
+                std::move(commandBuffer);
+            recording_ = true;
+        }
+
+        return device_->hasDedicatedTransferQueue() ? batch_.transferCommandBuffer : batch_.graphicsCommandBuffer;
+    }
+
+    void UploadBatcher::releaseToGraphics(const vk::BufferMemoryBarrier2& barrier) {
+        if (!device_->hasDedicatedTransferQueue()) {
+            return;
+        }
+
+        auto& release = bufferOwnershipBarriers_.emplace_back(barrier);
+        release.srcStageMask = vk::PipelineStageFlagBits2::eTransfer;
+        release.srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+        release.srcQueueFamilyIndex = device_->getTransferQueue().familyIndex;
+        release.dstQueueFamilyIndex = device_->getQueue().familyIndex;
+    }
+
+    void UploadBatcher::releaseToGraphics(const vk::ImageMemoryBarrier2& barrier) {
+        if (!device_->hasDedicatedTransferQueue()) {
+            return;
+        }
+
+        auto& release = imageOwnershipBarriers_.emplace_back(barrier);
+        release.srcStageMask = vk::PipelineStageFlagBits2::eTransfer;
+        release.srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+        release.srcQueueFamilyIndex = device_->getTransferQueue().familyIndex;
+        release.dstQueueFamilyIndex = device_->getQueue().familyIndex;
+    }
+
+}
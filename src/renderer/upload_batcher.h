@@ -0,0 +1,116 @@
+#pragma once
+
+#include "core/util.h"
+#include "renderer/mip_generator.h"
+#include "renderer/vulkan_usage.h"
+#include "renderer/vma/buffer.h"
+#include "renderer/vma/staging_allocator.h"
+#include "pch.h"
+#include <deque>
+
+namespace yuubi {
+
+    class Device;
+    class Image;
+    struct ImageData;
+
+    struct StagingAllocation {
+        std::span<std::byte> memory;
+        vk::Buffer buffer;
+        vk::DeviceSize offset;
+    };
+
+    // Records many buffer and image uploads and submits them together.
+    // Staging memory is sub-allocated from blocks borrowed from the device's
+    // StagingAllocator, so load time scales with the number of bytes moved
+    // instead of the number of objects.
+    //
+    // Copies run on the device's transfer queue when it has one. Ownership of
+    // the written resources is then released to the graphics queue, which
+    // acquires it and generates mipmaps for the whole batch with the device's
+    // MipGenerator, falling back to blits for formats it can't write.
+    // Submissions signal the device's upload timeline rather than blocking the
+    // CPU, and staging memory is returned to the pool once a batch has
+    // retired.
+    //
+    // Uploads are flushed automatically once the batcher holds more than
+    // maxStagingBytes of staging memory. Data is copied into staging memory
+    // when an upload is recorded, so the source may be freed immediately
+    // afterwards.
+    class UploadBatcher : NonCopyable {
+    public:
+        static constexpr vk::DeviceSize defaultMaxStagingBytes = 256ull * 1024 * 1024;
+
+        UploadBatcher() = default;
+        explicit UploadBatcher(const Device& device, vk::DeviceSize maxStagingBytes = defaultMaxStagingBytes);
+        UploadBatcher(UploadBatcher&& rhs) noexcept;
+        UploadBatcher& operator=(UploadBatcher&& rhs) noexcept;
+        ~UploadBatcher();
+
+        [[nodiscard]] StagingAllocation allocateStaging(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+        void uploadBuffer(const Buffer& buffer, const void* data, vk::DeviceSize size, vk::DeviceSize offset = 0);
+
+        // Creates a sampled image with a full mip chain. Uploads every level
+        // when data has a prebuilt mip chain, otherwise uploads the base level
+        // and records mip generation. If withinBudget is set, nothing is
+        // recorded and an empty image is returned when the image would exceed
+        // the heap budget.
+        [[nodiscard]] Image createImage(const ImageData& data, bool withinBudget = false);
+
+        // Submits all recorded uploads without waiting for them. Returns the
+        // upload timeline value that is signalled once every upload submitted
+        // so far has completed.
+        uint64_t flush();
+        // Blocks until all submitted uploads have completed.
+        void wait();
+
+        // Bytes recorded since the last flush.
+        [[nodiscard]] vk::DeviceSize pendingBytes() const { return pendingBytes_; }
+
+    private:
+        struct Batch {
+            vk::raii::CommandBuffer transferCommandBuffer = nullptr;
+            vk::raii::CommandBuffer graphicsCommandBuffer = nullptr;
+            // Signalled by the transfer queue once copies are done.
+            vk::raii::Semaphore copiesDone = nullptr;
+            std::vector<std::unique_ptr<StagingBlock>> stagingBlocks;
+            MipGenerator::Resources mipResources;
+            uint64_t timelineValue = 0;
+        };
+
+        [[nodiscard]] const vk::raii::CommandBuffer& transferCommandBuffer();
+        void releaseToGraphics(const vk::BufferMemoryBarrier2& barrier);
+        void releaseToGraphics(const vk::ImageMemoryBarrier2& barrier);
+        // Returns staging memory of batches that have completed, optionally
+        // waiting until at most maxStagingBytes_ are in use.
+        void retireBatches(bool waitForBudget);
+
+        const Device* device_ = nullptr;
+
+        // Staging allocations are made linearly from the last block of the
+        // current batch.
+        vk::DeviceSize stagingHead_ = 0;
+        // Staging memory held by the current and in-flight batches.
+        vk::DeviceSize stagingBytes_ = 0;
+        vk::DeviceSize maxStagingBytes_ = 0;
+
+        vk::raii::CommandPool transferCommandPool_ = nullptr;
+        vk::raii::CommandPool graphicsCommandPool_ = nullptr;
+
+        Batch batch_;
+        bool recording_ = false;
+        std::vector<vk::BufferMemoryBarrier2> bufferOwnershipBarriers_;
+        std::vector<vk::ImageMemoryBarrier2> imageOwnershipBarriers_;
+        std::vector<MipGenerator::Request> mipGenerations_;
+        // Images whose format the MipGenerator can't write.
+        std::vector<MipGenerator::Request> blitMipGenerations_;
+
+        std::deque<Batch> inFlightBatches_;
+        uint64_t lastTimelineValue_ = 0;
+
+        size_t pendingUploads_ = 0;
+        vk::DeviceSize pendingBytes_ = 0;
+    };
+
+}
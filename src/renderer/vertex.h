@@ -15,4 +15,57 @@ namespace yuubi {
         glm::vec4 tangent;
     };
 
+    // Vertex quantized to 20 bytes. Decoded by decodeVertex() in vertex.glsl.
+    struct CompactVertex {
+        // Position x and y as unorm16 fractions of the mesh's position bounds.
+        uint32_t positionXY;
+        // Position z as unorm16 and the bitangent sign as snorm16.
+        uint32_t positionZTangentSign;
+        // Two half floats.
+        uint32_t uv;
+        // Octahedral encoded unit vectors, as snorm16 pairs.
+        uint32_t normal;
+        uint32_t tangent;
+    };
+
+    struct CompactColorVertex {
+        CompactVertex vertex;
+        // Unorm8 RGBA.
+        uint32_t color;
+    };
+
+    // Layout of a mesh's vertices. Must match VERTEX_FORMAT_* in vertex.glsl.
+    enum class VertexFormat : uint32_t {
+        // Vertex.
+        Full,
+        // CompactVertex. Used for meshes without vertex colors.
+        Compact,
+        // CompactColorVertex.
+        CompactColor,
+    };
+
+    [[nodiscard]] constexpr uint32_t vertexStride(VertexFormat format) {
+        switch (format) {
+            case VertexFormat::Compact:
+                return sizeof(CompactVertex);
+            case VertexFormat::CompactColor:
+                return sizeof(CompactColorVertex);
+            default:
+                return sizeof(Vertex);
+        }
+    }
+
+    [[nodiscard]] constexpr uint32_t indexSize(vk::IndexType indexType) {
+        return indexType == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+    // How a mesh's vertices and indices are encoded.
+    struct GeometryFormat {
+        VertexFormat vertexFormat = VertexFormat::Full;
+        vk::IndexType indexType = vk::IndexType::eUint32;
+        // Bounds compact positions are quantized to. Unused by full vertices.
+        glm::vec3 positionMin{0.0f};
+        glm::vec3 positionExtent{1.0f};
+    };
+
 }
@@ -45,7 +45,7 @@ namespace yuubi {
     }
 
     void Viewport::recreateSwapChain() {
-        device_->getDevice().waitIdle();
+        device_->waitIdle();
         createSwapChain();
         createImageViews();
         createDepthStencil();
@@ -319,7 +319,7 @@ namespace yuubi {
 
         vk::Result presentResult;
         try {
-            presentResult = device_->getQueue().queue.presentKHR(presentInfo);
+            presentResult = device_->present(presentInfo);
         } catch (const std::exception& e) {
             frameBufferResized_ = true;
         }
@@ -57,6 +57,7 @@ namespace yuubi {
         [[nodiscard]] const vk::Format& getDepthFormat() const { return depthImageFormat_; }
         static const uint32_t maxFramesInFlight = 2;
         [[nodiscard]] std::array<Frame, maxFramesInFlight>& frames() { return frames_; }
+        [[nodiscard]] uint32_t currentFrameIndex() const { return currentFrame_; }
 
     private:
         void createSwapChain();
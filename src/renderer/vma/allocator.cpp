@@ -4,10 +4,15 @@ namespace yuubi {
 
     Allocator::Allocator(
         const vk::raii::Instance& instance, const vk::raii::PhysicalDevice& physicalDevice,
-        const vk::raii::Device& device
+        const vk::raii::Device& device, bool memoryBudget
     ) : device_(&device) {
+        VmaAllocatorCreateFlags flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+        if (memoryBudget) {
+            flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+        }
+
         const VmaAllocatorCreateInfo allocatorInfo{
-            .flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
+            .flags = flags,
             .physicalDevice = *physicalDevice,
             .device = *device,
             .instance = *instance,
@@ -33,5 +38,23 @@ namespace yuubi {
 
     Allocator::~Allocator() { vmaDestroyAllocator(allocator_); }
 
+    void Allocator::setFrameIndex(uint32_t frameIndex) const { vmaSetCurrentFrameIndex(allocator_, frameIndex); }
+
+    MemoryBudget Allocator::deviceLocalBudget() const {
+        const VkPhysicalDeviceMemoryProperties* properties;
+        vmaGetMemoryProperties(allocator_, &properties);
+        std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets;
+        vmaGetHeapBudgets(allocator_, budgets.data());
+
+        MemoryBudget total;
+        for (uint32_t heap = 0; heap < properties->memoryHeapCount; heap++) {
+            if (properties->memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+                total.usage += budgets[heap].usage;
+                total.budget += budgets[heap].budget;
+            }
+        }
+        return total;
+    }
+
 
 }
@@ -5,12 +5,22 @@
 
 namespace yuubi {
 
+    struct MemoryBudget {
+        // Bytes allocated by the process.
+        vk::DeviceSize usage = 0;
+        // Bytes the process can allocate before the driver starts paging or
+        // failing allocations.
+        vk::DeviceSize budget = 0;
+    };
+
     // RAII wrapper over VmaAllocator
     class Allocator : NonCopyable {
     public:
+        // memoryBudget must be set if VK_EXT_memory_budget is enabled on
+        // device. Budgets are estimated from the heap sizes otherwise.
         Allocator(
             const vk::raii::Instance& instance, const vk::raii::PhysicalDevice& physicalDevice,
-            const vk::raii::Device& device
+            const vk::raii::Device& device, bool memoryBudget
         );
         Allocator(std::nullptr_t) {};
         Allocator(Allocator&& rhs) noexcept;
@@ -20,6 +30,11 @@ namespace yuubi {
         [[nodiscard]] const VmaAllocator& getAllocator() const { return allocator_; }
         [[nodiscard]] const vk::raii::Device& getDevice() const { return *device_; }
 
+        // Lets VMA refresh its cached budgets. Must be called once per frame.
+        void setFrameIndex(uint32_t frameIndex) const;
+        // Summed over device-local heaps.
+        [[nodiscard]] MemoryBudget deviceLocalBudget() const;
+
     private:
         VmaAllocator allocator_;
         // TODO: make shared
@@ -19,7 +19,17 @@ namespace yuubi {
         Buffer& operator=(Buffer&& rhs) noexcept;
         ~Buffer();
 
+        // Copies through a pooled staging block and waits for the copy. Use an
+        // UploadBatcher when uploading many buffers at once.
         void upload(const Device& device, const void* data, size_t size, size_t offset) const;
+        // Writes directly into host-visible, persistently mapped memory.
+        void write(const void* data, size_t size, size_t offset) const;
+        // Makes host writes to mapped memory visible to the device. No-op for
+        // host-coherent memory.
+        void flush(size_t offset, size_t size) const;
+        // Makes device writes to mapped memory visible to the host. No-op for
+        // host-coherent memory.
+        void invalidate(size_t offset, size_t size) const;
 
         [[nodiscard]] const vk::raii::Buffer& getBuffer() const { return buffer_; }
         [[nodiscard]] void* getMappedMemory() const { return allocationInfo_.pMappedData; }
@@ -31,10 +41,6 @@ namespace yuubi {
         VmaAllocation allocation_ = nullptr;
         VmaAllocationInfo allocationInfo_;
         vk::DeviceAddress address_;
-
-        vk::raii::Buffer stagingBuffer_ = nullptr;
-        VmaAllocationInfo stagingBufferAllocationInfo_;
-        VmaAllocation stagingBufferAllocation_;
     };
 
 }
@@ -17,6 +17,26 @@ namespace yuubi {
         vk::MemoryPropertyFlags properties;
         uint32_t mipLevels = 1;
         uint32_t arrayLayers = 1;
+        vk::ImageCreateFlags flags = {};
+        // Formats views of a mutable format image are created with.
+        std::span<const vk::Format> viewFormats = {};
+        // Fails the allocation rather than exceed the heap budget, leaving
+        // the image empty.
+        bool withinBudget = false;
+    };
+
+    // Location of a mip level within ImageData::pixels.
+    struct ImageMipLevel {
+        vk::DeviceSize offset;
+        vk::DeviceSize size;
+    };
+
+    // How generated mip levels are filtered. Color is always averaged in
+    // linear space.
+    enum class MipFilter {
+        Average,
+        // Tangent space normals, renormalized after averaging.
+        Normal,
     };
 
     struct ImageData {
@@ -24,8 +44,14 @@ namespace yuubi {
         unsigned char* pixels;
         uint32_t width;
         uint32_t height;
+        // Channels of pixels. 8-bit RGBA images with fewer channels are
+        // expanded to RGBA on upload, gray being replicated to RGB.
         uint32_t numChannels;
         vk::Format format;
+        // Prebuilt mip chain, starting at the base level. When empty, pixels
+        // holds only the base level and the rest of the chain is generated.
+        std::span<const ImageMipLevel> mipLevels = {};
+        MipFilter mipFilter = MipFilter::Average;
     };
 
     class Image : NonCopyable {
@@ -39,6 +65,8 @@ namespace yuubi {
         [[nodiscard]] const vk::raii::Image& getImage() const { return image_; }
         [[nodiscard]] vk::Format getImageFormat() const { return format_; }
         [[nodiscard]] uint32_t getMipLevels() const { return mipLevels_; }
+        // False for default constructed images and failed allocations.
+        [[nodiscard]] bool isAllocated() const { return allocation_ != nullptr; }
 
     private:
         void destroy();
@@ -56,6 +84,12 @@ namespace yuubi {
         VmaAllocation allocation_ = nullptr;
     };
 
+    // The levels of data from firstMip on, as an image of their own. data
+    // must have a prebuilt mip chain.
+    [[nodiscard]] ImageData mipTail(const ImageData& data, uint32_t firstMip);
+
     class Device;
+    // Uploads a single image and waits for it. Use an UploadBatcher when
+    // uploading many images at once.
     Image createImageFromData(const Device& device, const ImageData& data);
 }
@@ -0,0 +1,74 @@
+#include "renderer/vma/staging_allocator.h"
+#include "renderer/vma/allocator.h"
+
+namespace yuubi {
+
+    StagingAllocator::StagingAllocator(Allocator* allocator, vk::DeviceSize maxRetainedBytes) :
+        allocator_(allocator), maxRetainedBytes_(maxRetainedBytes) {}
+
+    std::unique_ptr<StagingBlock> StagingAllocator::acquire(vk::DeviceSize minSize) {
+        {
+            std::lock_guard lock(mutex_);
+
+            // Reuse the smallest idle block that fits.
+            auto best = freeBlocks_.end();
+            for (auto it = freeBlocks_.begin(); it != freeBlocks_.end(); ++it) {
+                if ((*it)->size >= minSize && (best == freeBlocks_.end() || (*it)->size < (*best)->size)) {
+                    best = it;
+                }
+            }
+
+            if (best != freeBlocks_.end()) {
+                auto block = std::move(*best);
+                freeBlocks_.erase(best);
+                retainedBytes_ -= block->size;
+                return block;
+            }
+        }
+
+        const vk::DeviceSize size = std::max(minSize, defaultBlockSize);
+
+        const vk::BufferCreateInfo createInfo{
+            .size = size,
+            .usage = vk::BufferUsageFlagBits::eTransferSrc,
+        };
+
+        const VmaAllocationCreateInfo allocCreateInfo{
+            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO,
+        };
+
+        auto block = std::make_unique<StagingBlock>();
+        block->buffer = Buffer(allocator_, createInfo, allocCreateInfo);
+        block->size = size;
+
+        std::lock_guard lock(mutex_);
+        liveBytes_ += size;
+
+        return block;
+    }
+
+    void StagingAllocator::release(std::unique_ptr<StagingBlock> block) {
+        std::lock_guard lock(mutex_);
+
+        if (retainedBytes_ + block->size > maxRetainedBytes_) {
+            // Free memory right away rather than hoarding it after a load.
+            liveBytes_ -= block->size;
+            return;
+        }
+
+        retainedBytes_ += block->size;
+        freeBlocks_.push_back(std::move(block));
+    }
+
+    vk::DeviceSize StagingAllocator::liveBytes() const {
+        std::lock_guard lock(mutex_);
+        return liveBytes_;
+    }
+
+    vk::DeviceSize StagingAllocator::retainedBytes() const {
+        std::lock_guard lock(mutex_);
+        return retainedBytes_;
+    }
+
+}
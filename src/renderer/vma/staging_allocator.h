@@ -0,0 +1,52 @@
+#pragma once
+
+#include "core/util.h"
+#include "renderer/vulkan_usage.h"
+#include "renderer/vma/buffer.h"
+#include "pch.h"
+#include <mutex>
+
+namespace yuubi {
+
+    class Allocator;
+
+    // Host-visible, persistently mapped buffer used as a copy source.
+    struct StagingBlock : NonCopyable {
+        Buffer buffer;
+        vk::DeviceSize size = 0;
+
+        [[nodiscard]] std::byte* data() const { return static_cast<std::byte*>(buffer.getMappedMemory()); }
+    };
+
+    // Pool of staging blocks shared by everything that uploads to the GPU.
+    // Blocks are handed out to the owner of a copy and returned once that copy
+    // has retired. Returned blocks are recycled, and any idle memory beyond
+    // the retention limit is freed immediately.
+    //
+    // Thread-safe.
+    class StagingAllocator : NonCopyableOrMovable {
+    public:
+        static constexpr vk::DeviceSize defaultBlockSize = 32ull * 1024 * 1024;
+        static constexpr vk::DeviceSize defaultMaxRetainedBytes = 64ull * 1024 * 1024;
+
+        explicit StagingAllocator(Allocator* allocator, vk::DeviceSize maxRetainedBytes = defaultMaxRetainedBytes);
+
+        // Returns a block of at least minSize bytes.
+        [[nodiscard]] std::unique_ptr<StagingBlock> acquire(vk::DeviceSize minSize);
+        // Must only be called once the GPU no longer reads from the block.
+        void release(std::unique_ptr<StagingBlock> block);
+
+        [[nodiscard]] vk::DeviceSize liveBytes() const;
+        [[nodiscard]] vk::DeviceSize retainedBytes() const;
+
+    private:
+        Allocator* allocator_;
+        vk::DeviceSize maxRetainedBytes_;
+
+        mutable std::mutex mutex_;
+        std::vector<std::unique_ptr<StagingBlock>> freeBlocks_;
+        vk::DeviceSize liveBytes_ = 0;
+        vk::DeviceSize retainedBytes_ = 0;
+    };
+
+}